@@ -68,6 +68,15 @@
   #define FREERTOS_MCU_CLOCK_HZ   72000000
 #endif
 
+/**
+ * \def CONTROL_FIXED_POINT
+ * Run the sensor fusion and the attitude and rate PIDs in fixed point. Set
+ * for the CF1 which has no FPU.
+ */
+#ifdef PLATFORM_CF1
+  #define CONTROL_FIXED_POINT
+#endif
+
 
 // Task priorities. Higher number higher priority
 #define STABILIZER_TASK_PRI     4
@@ -76,6 +85,7 @@
 #define CRTP_TX_TASK_PRI        2
 #define CRTP_RX_TASK_PRI        2
 #define LOG_TASK_PRI            1
+#define LOG_SCHED_TASK_PRI      2
 #define MEM_TASK_PRI            1
 #define PARAM_TASK_PRI          1
 #define PROXIMITY_TASK_PRI      0
@@ -107,6 +117,7 @@
 #define CRTP_RX_TASK_NAME       "CRTP-RX"
 #define CRTP_RXTX_TASK_NAME     "CRTP-RXTX"
 #define LOG_TASK_NAME           "LOG"
+#define LOG_SCHED_TASK_NAME     "LOGSCHED"
 #define MEM_TASK_NAME           "MEM"
 #define PARAM_TASK_NAME         "PARAM"
 #define STABILIZER_TASK_NAME    "STABILIZER"
@@ -127,6 +138,7 @@
 #define CRTP_RX_TASK_STACKSIZE        configMINIMAL_STACK_SIZE
 #define CRTP_RXTX_TASK_STACKSIZE      configMINIMAL_STACK_SIZE
 #define LOG_TASK_STACKSIZE            configMINIMAL_STACK_SIZE
+#define LOG_SCHED_TASK_STACKSIZE      configMINIMAL_STACK_SIZE
 #define MEM_TASK_STACKSIZE            configMINIMAL_STACK_SIZE
 #define PARAM_TASK_STACKSIZE          configMINIMAL_STACK_SIZE
 #define STABILIZER_TASK_STACKSIZE     (3 * configMINIMAL_STACK_SIZE)
@@ -37,6 +37,7 @@
 #include "pm.h"
 #include "log.h"
 #include "piezo.h"
+#include "stabilizer.h"
 
 typedef void (*BuzzerEffect)(uint32_t timer);
 
@@ -243,19 +244,17 @@ static void siren(uint32_t counter)
 }
 
 
-static int pitchid;
-static int rollid;
 static int pitch;
 static int roll;
 static int tilt_freq;
 static int tilt_ratio;
 static void tilt(uint32_t counter)
 {
-  pitchid = logGetVarId("stabilizer", "pitch");
-  rollid = logGetVarId("stabilizer", "roll");
+  vehicleState_t state;
 
-  pitch = logGetInt(pitchid);
-  roll = logGetInt(rollid);
+  stabilizerGetState(&state);
+  pitch = state.pitch;
+  roll = state.roll;
   tilt_freq = 0;
   tilt_ratio = 127;
 
@@ -43,6 +43,7 @@
 #include "param.h"
 #include "pm.h"
 #include "log.h"
+#include "stabilizer.h"
 
 
 /*
@@ -306,7 +307,7 @@ static void doubleSpinEffect(uint8_t buffer[][3], bool reset) {
 
 static void tiltEffect(uint8_t buffer[][3], bool reset)
 {
-  static int pitchid, rollid, thrust=-1;
+  vehicleState_t state;
 
   // 2014-12-28 chad: Reset LEDs to off to avoid color artifacts
   // when switching from other effects.
@@ -321,38 +322,33 @@ static void tiltEffect(uint8_t buffer[][3], bool reset)
     }
 
 
-  if (thrust<0) {
-    //Init
-    pitchid = logGetVarId("stabilizer", "pitch");
-    rollid = logGetVarId("stabilizer", "roll");
-    thrust = logGetVarId("stabilizer", "thrust");
-  } else {
-    const int led_middle = 10;
-    float pitch = -1*logGetFloat(pitchid);
-    float roll  = -1*logGetFloat(rollid);
+  stabilizerGetState(&state);
 
-    pitch = (pitch>20)?20:(pitch<-20)?-20:pitch;
-    roll = (roll>20)?20:(roll<-20)?-20:roll;
+  const int led_middle = 10;
+  float pitch = -1*state.pitch;
+  float roll  = -1*state.roll;
 
-    pitch=SIGN(pitch)*pitch*pitch;
-    roll*=SIGN(roll)*roll;
+  pitch = (pitch>20)?20:(pitch<-20)?-20:pitch;
+  roll = (roll>20)?20:(roll<-20)?-20:roll;
 
-    buffer[11][0] = LIMIT(led_middle + pitch);
-    buffer[0][0] = LIMIT(led_middle + pitch);
-    buffer[1][0] = LIMIT(led_middle + pitch);
+  pitch=SIGN(pitch)*pitch*pitch;
+  roll*=SIGN(roll)*roll;
 
-    buffer[2][2] = LIMIT(led_middle - roll);
-    buffer[3][2] = LIMIT(led_middle - roll);
-    buffer[4][2] = LIMIT(led_middle - roll);
+  buffer[11][0] = LIMIT(led_middle + pitch);
+  buffer[0][0] = LIMIT(led_middle + pitch);
+  buffer[1][0] = LIMIT(led_middle + pitch);
 
-    buffer[5][0] = LIMIT(led_middle - pitch);
-    buffer[6][0] = LIMIT(led_middle - pitch);
-    buffer[7][0] = LIMIT(led_middle - pitch);
+  buffer[2][2] = LIMIT(led_middle - roll);
+  buffer[3][2] = LIMIT(led_middle - roll);
+  buffer[4][2] = LIMIT(led_middle - roll);
 
-    buffer[8][2] = LIMIT(led_middle + roll);
-    buffer[9][2] = LIMIT(led_middle + roll);
-    buffer[10][2] = LIMIT(led_middle + roll);
-  }
+  buffer[5][0] = LIMIT(led_middle - pitch);
+  buffer[6][0] = LIMIT(led_middle - pitch);
+  buffer[7][0] = LIMIT(led_middle - pitch);
+
+  buffer[8][2] = LIMIT(led_middle + roll);
+  buffer[9][2] = LIMIT(led_middle + roll);
+  buffer[10][2] = LIMIT(led_middle + roll);
 }
 
 
@@ -363,17 +359,12 @@ static void gravityLightRender(uint8_t buffer[][3], float led_index, int intensi
 
 static void gravityLight(uint8_t buffer[][3], bool reset)
 {
-  static int pitchid, rollid;
-  static bool isInitialized = false;
+  vehicleState_t state;
 
-  if (!isInitialized) {
-    pitchid = logGetVarId("stabilizer", "pitch");
-    rollid = logGetVarId("stabilizer", "roll");
-    isInitialized = true;
-  }
+  stabilizerGetState(&state);
 
-  float pitch = logGetFloat(pitchid); // -180 to 180
-  float roll = logGetFloat(rollid); // -180 to 180
+  float pitch = state.pitch; // -180 to 180
+  float roll = state.roll; // -180 to 180
 
   float angle = gravityLightCalculateAngle(pitch, roll);
   float led_index = NBR_LEDS * angle / (2 * (float) M_PI);
@@ -419,45 +410,37 @@ static void gravityLightRender(uint8_t buffer[][3], float led_index, int intensi
 static void brightnessEffect(uint8_t buffer[][3], bool reset)
 {
 
-  static int gyroYid, gyroZid, gyroXid =- 1;
   static uint8_t brightness = 0;
+  vehicleState_t state;
 
-  if (gyroXid < 0)
-  {
-    //Init
-    gyroXid = logGetVarId("gyro", "x");
-    gyroYid = logGetVarId("gyro", "y");
-    gyroZid = logGetVarId("gyro", "z");
-  }
-  else
-  {
-    int i;
-    int gyroX = (int)logGetFloat(gyroXid);
-    int gyroY = (int)logGetFloat(gyroYid);
-    int gyroZ = (int)logGetFloat(gyroZid);
+  stabilizerGetState(&state);
 
-    // Adjust to interval
-    gyroX = (gyroX>MAX_RATE) ? MAX_RATE:(gyroX<-MAX_RATE) ? -MAX_RATE:gyroX;
-    gyroY = (gyroY>MAX_RATE) ? MAX_RATE:(gyroY<-MAX_RATE) ? -MAX_RATE:gyroY;
-    gyroZ = (gyroZ>MAX_RATE) ? MAX_RATE:(gyroZ<-MAX_RATE) ? -MAX_RATE:gyroZ;
+  int i;
+  int gyroX = (int)state.rollRate;
+  int gyroY = (int)state.pitchRate;
+  int gyroZ = (int)state.yawRate;
 
-    gyroX = SIGN(gyroX) * gyroX / 2;
-    gyroY = SIGN(gyroY) * gyroY / 2;
-    gyroZ = SIGN(gyroZ) * gyroZ / 2;
+  // Adjust to interval
+  gyroX = (gyroX>MAX_RATE) ? MAX_RATE:(gyroX<-MAX_RATE) ? -MAX_RATE:gyroX;
+  gyroY = (gyroY>MAX_RATE) ? MAX_RATE:(gyroY<-MAX_RATE) ? -MAX_RATE:gyroY;
+  gyroZ = (gyroZ>MAX_RATE) ? MAX_RATE:(gyroZ<-MAX_RATE) ? -MAX_RATE:gyroZ;
 
-    gyroX = DEADBAND(gyroX, 5);
-    gyroY = DEADBAND(gyroY, 5);
-    gyroZ = DEADBAND(gyroZ, 5);
+  gyroX = SIGN(gyroX) * gyroX / 2;
+  gyroY = SIGN(gyroY) * gyroY / 2;
+  gyroZ = SIGN(gyroZ) * gyroZ / 2;
 
-    for (i=0; i < NBR_LEDS; i++)
-    {
-      buffer[i][0] = (uint8_t)(LIMIT(gyroZ));
-      buffer[i][1] = (uint8_t)(LIMIT(gyroY));
-      buffer[i][2] = (uint8_t)(LIMIT(gyroX));
-    }
+  gyroX = DEADBAND(gyroX, 5);
+  gyroY = DEADBAND(gyroY, 5);
+  gyroZ = DEADBAND(gyroZ, 5);
 
-    brightness++;
+  for (i=0; i < NBR_LEDS; i++)
+  {
+    buffer[i][0] = (uint8_t)(LIMIT(gyroZ));
+    buffer[i][1] = (uint8_t)(LIMIT(gyroY));
+    buffer[i][2] = (uint8_t)(LIMIT(gyroX));
   }
+
+  brightness++;
 }
 
 
@@ -101,6 +101,23 @@
 #define MOTOR_M3  2
 #define MOTOR_M4  3
 
+/**
+ * Thrust linearization table. Thrust (0 - 65535) is split in
+ * (1 << MOTORS_THRUST_LUT_BITS) equal segments and the PWM ratio is linearly
+ * interpolated between the table points. Table values are PWM ratios
+ * (0 - 65535) that give the wanted thrust at MOTORS_BAT_NOMINAL_VOLTAGE.
+ */
+#define MOTORS_THRUST_LUT_BITS    3
+#define MOTORS_THRUST_LUT_SIZE    ((1 << MOTORS_THRUST_LUT_BITS) + 1)
+#define MOTORS_THRUST_LUT_SHIFT   (16 - MOTORS_THRUST_LUT_BITS)
+
+// Battery compensation factor is a fixed point value with this many fractional bits
+#define MOTORS_BAT_COMP_SHIFT       12
+#define MOTORS_BAT_COMP_UNITY       (1 << MOTORS_BAT_COMP_SHIFT)
+#define MOTORS_BAT_COMP_MAX         (2 * MOTORS_BAT_COMP_UNITY)
+#define MOTORS_BAT_NOMINAL_VOLTAGE  3.7f
+#define MOTORS_BAT_MIN_VOLTAGE      2.5f  // Below this the measurement is not trusted
+
 // Test defines
 #define MOTORS_TEST_RATIO         (uint16_t)(0.2*(1<<16))
 #define MOTORS_TEST_ON_TIME_MS    50
@@ -226,6 +243,32 @@ bool motorsTest(void);
  */
 void motorsSetRatio(uint32_t id, uint16_t ratio);
 
+/**
+ * Start updating several motors at once. The ratios set until
+ * motorsCommitUpdate() are staged and all take effect at the same update
+ * event, so no PWM period runs with only some of the motors updated.
+ */
+void motorsBeginUpdate(void);
+
+/**
+ * Apply the ratios staged since motorsBeginUpdate(). With brushed motors the
+ * PWM period is restarted so they apply right away, aligned to the caller.
+ */
+void motorsCommitUpdate(void);
+
+/**
+ * Get the battery compensation factor for the given supply voltage. The factor
+ * is computed once per control cycle and passed to motorsSetThrust().
+ */
+uint32_t motorsGetBatteryCompensation(float supplyVoltage);
+
+/**
+ * Set the thrust of the motor 'id'. The thrust (0 - 65535) is mapped to a PWM
+ * ratio through the linearization table and scaled with the battery
+ * compensation factor.
+ */
+void motorsSetThrust(uint32_t id, uint16_t thrust, uint32_t batCompensation);
+
 /**
  * Get the PWM ratio of the motor 'id'. Return -1 if wrong ID.
  */
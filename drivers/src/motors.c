@@ -39,6 +39,7 @@
 
 //Logging includes
 #include "log.h"
+#include "param.h"
 
 static uint16_t motorsBLConvBitsTo16(uint16_t bits);
 static uint16_t motorsBLConv16ToBits(uint16_t bits);
@@ -47,6 +48,17 @@ static uint16_t motorsConv16ToBits(uint16_t bits);
 
 uint32_t motor_ratios[] = {0, 0, 0, 0};
 
+#ifdef ENABLE_THRUST_BAT_COMPENSATED
+/* Thrust to PWM table at MOTORS_BAT_NOMINAL_VOLTAGE. Based on thrust
+ * measurement: volts = -0.0006239 * g^2 + 0.088 * g with 65536 <==> 60g. */
+static uint16_t motorsThrustLut[MOTORS_THRUST_LUT_SIZE] =
+  { 0, 11068, 20894, 29476, 36815, 42910, 47763, 51372, 53738 };
+#else
+static uint16_t motorsThrustLut[MOTORS_THRUST_LUT_SIZE] =
+  { 0, 8192, 16384, 24576, 32768, 40960, 49152, 57344, 65535 };
+#endif
+static uint32_t motorsBatCompensation = MOTORS_BAT_COMP_UNITY;
+
 void motorsPlayTone(uint16_t frequency, uint16_t duration_msec);
 void motorsPlayMelody(uint16_t *notes);
 void motorsBeep(int id, bool enable, uint16_t frequency, uint16_t ratio);
@@ -65,6 +77,14 @@ static const uint16_t testsound[NBR_OF_MOTORS] = {A4, A5, F5, D5 };
 
 static bool isInit = false;
 
+/* Timers driving the motors, each listed once. Compare values are staged in
+ * the preload registers and transferred on the timers' update event. */
+static TIM_TypeDef* motorsTimers[NBR_OF_MOTORS];
+static int motorsTimerCount;
+static bool motorsAllBrushed;
+// Restart the PWM period on commit so the new ratios apply right away
+static uint8_t motorsAlignUpdate = 1;
+
 /* Private functions */
 
 static uint16_t motorsBLConvBitsTo16(uint16_t bits)
@@ -148,6 +168,23 @@ void motorsInit(const MotorPerifDef** motorMapSelect)
     TIM_CtrlPWMOutputs(motorMap[i]->tim, ENABLE);
   }
 
+  motorsTimerCount = 0;
+  motorsAllBrushed = true;
+  for (i = 0; i < NBR_OF_MOTORS; i++)
+  {
+    int j;
+
+    for (j = 0; j < motorsTimerCount && motorsTimers[j] != motorMap[i]->tim; j++);
+    if (j == motorsTimerCount)
+    {
+      motorsTimers[motorsTimerCount++] = motorMap[i]->tim;
+    }
+    if (motorMap[i]->drvType != BRUSHED)
+    {
+      motorsAllBrushed = false;
+    }
+  }
+
   // Start the timers
   for (i = 0; i < NBR_OF_MOTORS; i++)
   {
@@ -207,36 +244,108 @@ bool motorsTest(void)
   return isInit;
 }
 
-// Ithrust is thrust mapped for 65536 <==> 60g
-void motorsSetRatio(uint32_t id, uint16_t ithrust)
+void motorsSetRatio(uint32_t id, uint16_t ratio)
 {
-  uint16_t ratio;
-
   ASSERT(id < NBR_OF_MOTORS);
 
-  ratio = ithrust;
+  motor_ratios[id] = ratio;
 
-#ifdef ENABLE_THRUST_BAT_COMPENSATED
-  if (motorMap[id]->drvType == BRUSHED)
+  if (motorMap[id]->drvType == BRUSHLESS)
+  {
+    motorMap[id]->setCompare(motorMap[id]->tim, motorsBLConv16ToBits(ratio));
+  }
+  else
+  {
+    motorMap[id]->setCompare(motorMap[id]->tim, motorsConv16ToBits(ratio));
+  }
+}
+
+void motorsBeginUpdate(void)
+{
+  int i;
+
+  // Hold the preload to shadow transfer until all motors are written
+  for (i = 0; i < motorsTimerCount; i++)
+  {
+    TIM_UpdateDisableConfig(motorsTimers[i], ENABLE);
+  }
+}
+
+void motorsCommitUpdate(void)
+{
+  int i;
+
+  for (i = 0; i < motorsTimerCount; i++)
   {
-    float thrust = ((float)ithrust / 65536.0f) * 60;
-    float volts = -0.0006239 * thrust * thrust + 0.088 * thrust;
-    float supply_voltage = pmGetBatteryVoltage();
-    float percentage = volts / supply_voltage;
-    percentage = percentage > 1.0 ? 1.0 : percentage;
-    ratio = percentage * UINT16_MAX;
-    motor_ratios[id] = ratio;
+    TIM_UpdateDisableConfig(motorsTimers[i], DISABLE);
+  }
 
+  // A brushed PWM period is a few us, cutting one short is harmless. The
+  // pulses of brushless ESCs must never be cut, they wait for their update.
+  if (motorsAlignUpdate && motorsAllBrushed)
+  {
+    for (i = 0; i < motorsTimerCount; i++)
+    {
+      TIM_GenerateEvent(motorsTimers[i], TIM_EventSource_Update);
+    }
   }
+}
+
+uint32_t motorsGetBatteryCompensation(float supplyVoltage)
+{
+#ifdef ENABLE_THRUST_BAT_COMPENSATED
+  uint32_t compensation = MOTORS_BAT_COMP_UNITY;
+
+  // One division per control cycle, the per motor scaling is done in fixed point
+  if (supplyVoltage > MOTORS_BAT_MIN_VOLTAGE)
+  {
+    compensation = (uint32_t)(MOTORS_BAT_NOMINAL_VOLTAGE * MOTORS_BAT_COMP_UNITY / supplyVoltage);
+  }
+  if (compensation > MOTORS_BAT_COMP_MAX)
+  {
+    compensation = MOTORS_BAT_COMP_MAX;
+  }
+  motorsBatCompensation = compensation;
+
+  return compensation;
+#else
+  return MOTORS_BAT_COMP_UNITY;
 #endif
+}
+
+// Ithrust is thrust mapped for 65536 <==> 60g
+void motorsSetThrust(uint32_t id, uint16_t ithrust, uint32_t batCompensation)
+{
+  uint32_t idx;
+  int32_t low;
+  int32_t ratio;
+
+  ASSERT(id < NBR_OF_MOTORS);
+
   if (motorMap[id]->drvType == BRUSHLESS)
   {
-    motorMap[id]->setCompare(motorMap[id]->tim, motorsBLConv16ToBits(ratio));
+    // The ESC does its own thrust mapping
+    motorsSetRatio(id, ithrust);
+    return;
   }
-  else
+
+  // Linear interpolation between the two closest table points
+  idx = ithrust >> MOTORS_THRUST_LUT_SHIFT;
+  low = motorsThrustLut[idx];
+  ratio = low + (((motorsThrustLut[idx + 1] - low) *
+                 (int32_t)(ithrust & ((1 << MOTORS_THRUST_LUT_SHIFT) - 1))) >> MOTORS_THRUST_LUT_SHIFT);
+
+  ratio = (ratio * batCompensation) >> MOTORS_BAT_COMP_SHIFT;
+  if (ratio > UINT16_MAX)
   {
-    motorMap[id]->setCompare(motorMap[id]->tim, motorsConv16ToBits(ratio));
+    ratio = UINT16_MAX;
   }
+  else if (ratio < 0)
+  {
+    ratio = 0;
+  }
+
+  motorsSetRatio(id, (uint16_t)ratio);
 }
 
 int motorsGetRatio(uint32_t id)
@@ -323,4 +432,22 @@ LOG_ADD(LOG_UINT32, m1_pwm, &motor_ratios[0])
 LOG_ADD(LOG_UINT32, m2_pwm, &motor_ratios[1])
 LOG_ADD(LOG_UINT32, m3_pwm, &motor_ratios[2])
 LOG_ADD(LOG_UINT32, m4_pwm, &motor_ratios[3])
+LOG_ADD(LOG_UINT32, batComp, &motorsBatCompensation)
 LOG_GROUP_STOP(pwm)
+
+// Thrust linearization table, calibrate at MOTORS_BAT_NOMINAL_VOLTAGE
+PARAM_GROUP_START(motorLut)
+PARAM_ADD(PARAM_UINT16, t0, &motorsThrustLut[0])
+PARAM_ADD(PARAM_UINT16, t1, &motorsThrustLut[1])
+PARAM_ADD(PARAM_UINT16, t2, &motorsThrustLut[2])
+PARAM_ADD(PARAM_UINT16, t3, &motorsThrustLut[3])
+PARAM_ADD(PARAM_UINT16, t4, &motorsThrustLut[4])
+PARAM_ADD(PARAM_UINT16, t5, &motorsThrustLut[5])
+PARAM_ADD(PARAM_UINT16, t6, &motorsThrustLut[6])
+PARAM_ADD(PARAM_UINT16, t7, &motorsThrustLut[7])
+PARAM_ADD(PARAM_UINT16, t8, &motorsThrustLut[8])
+PARAM_GROUP_STOP(motorLut)
+
+PARAM_GROUP_START(motors)
+PARAM_ADD(PARAM_UINT8, alignUpdate, &motorsAlignUpdate)
+PARAM_GROUP_STOP(motors)
@@ -0,0 +1,57 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * cyclecounter.h - CPU cycle counter for execution time measurements
+ */
+#ifndef CYCLECOUNTER_H_
+#define CYCLECOUNTER_H_
+
+#include <stdint.h>
+
+/* Cortex-M3/M4 DWT cycle counter registers. Given by address since the CMSIS
+ * version used for the CF1 does not define the DWT. */
+#define CYCLECOUNTER_DEMCR         (*(volatile uint32_t*)0xE000EDFC)
+#define CYCLECOUNTER_DWT_CTRL      (*(volatile uint32_t*)0xE0001000)
+#define CYCLECOUNTER_DWT_CYCCNT    (*(volatile uint32_t*)0xE0001004)
+#define CYCLECOUNTER_DEMCR_TRCENA  (1UL << 24)
+#define CYCLECOUNTER_CYCCNTENA     (1UL << 0)
+
+/**
+ * Enable the free running CPU cycle counter.
+ */
+static inline void cycleCounterInit(void)
+{
+  CYCLECOUNTER_DEMCR |= CYCLECOUNTER_DEMCR_TRCENA;
+  CYCLECOUNTER_DWT_CYCCNT = 0;
+  CYCLECOUNTER_DWT_CTRL |= CYCLECOUNTER_CYCCNTENA;
+}
+
+/**
+ * @return The CPU cycle count. Wraps, differences are valid for 2^32 cycles.
+ */
+static inline uint32_t cycleCounterGet(void)
+{
+  return CYCLECOUNTER_DWT_CYCCNT;
+}
+
+#endif /* CYCLECOUNTER_H_ */
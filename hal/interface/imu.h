@@ -58,6 +58,12 @@ void imu6Read(Axis3f* gyro, Axis3f* acc);
 void imu9Read(Axis3f* gyroOut, Axis3f* accOut, Axis3f* magOut);
 bool imu6IsCalibrated(void);
 bool imuHasBarometer(void);
+/**
+ * Put the magnetometer and barometer in (or take them out of) a low power
+ * state. While in low power imu9Read() keeps returning the last magnetometer
+ * value and the barometer should not be read.
+ */
+void imuSetLowPower(bool lowPower);
 bool imuHasMangnetometer(void);
 
 
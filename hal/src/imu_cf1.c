@@ -95,6 +95,7 @@ static Axis3i32   accelStoredFilterValues;
 static uint8_t    imuAccLpfAttFactor;
 static bool       isHmc5883lPresent;
 static bool       isMs5611Present;
+static bool       isLowPower;
 
 static bool isMpu6050TestPassed;
 static bool isHmc5883lTestPassed;
@@ -304,7 +305,11 @@ void imu9Read(Axis3f* gyroOut, Axis3f* accOut, Axis3f* magOut)
 {
   imu6Read(gyroOut, accOut);
 
-  if (isHmc5883lPresent)
+  if (isLowPower)
+  {
+    // Magnetometer measurements are not triggered, keep the last value
+  }
+  else if (isHmc5883lPresent)
   {
     hmc5883lGetHeading(&mag.x, &mag.y, &mag.z);
     magOut->x = (float)mag.x / MAG_GAUSS_PER_LSB;
@@ -331,6 +336,13 @@ bool imu6IsCalibrated(void)
   return status;
 }
 
+void imuSetLowPower(bool lowPower)
+{
+  // The HMC5883L returns to idle after each single measurement and the
+  // MS5611 only converts when read, so not reading them is enough.
+  isLowPower = lowPower;
+}
+
 bool imuHasBarometer(void)
 {
   return isMs5611Present;
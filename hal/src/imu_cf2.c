@@ -103,6 +103,7 @@ static Axis3i32   accelStoredFilterValues;
 static uint8_t    imuAccLpfAttFactor;
 static bool isMagPresent;
 static bool isBaroPresent;
+static bool isLowPower;
 
 static bool isMpu6500TestPassed = true;
 static bool isAK8963TestPassed = true;
@@ -386,7 +387,11 @@ void imu9Read(Axis3f* gyroOut, Axis3f* accOut, Axis3f* magOut)
 {
   imu6Read(gyroOut, accOut);
 
-  if (isMagPresent)
+  if (isLowPower)
+  {
+    // Magnetometer is powered down, keep the last value
+  }
+  else if (isMagPresent)
   {
     ak8963GetHeading(&mag.x, &mag.y, &mag.z);
     ak8963GetOverflowStatus();
@@ -402,6 +407,23 @@ void imu9Read(Axis3f* gyroOut, Axis3f* accOut, Axis3f* magOut)
   }
 }
 
+void imuSetLowPower(bool lowPower)
+{
+  if (lowPower == isLowPower)
+    return;
+
+  if (isMagPresent)
+  {
+    ak8963SetMode(lowPower ? AK8963_MODE_POWERDOWN : (AK8963_MODE_16BIT | AK8963_MODE_CONT2));
+  }
+  if (isBaroPresent)
+  {
+    lps25hSetEnabled(!lowPower);
+  }
+
+  isLowPower = lowPower;
+}
+
 bool imuHasBarometer(void)
 {
   return isBaroPresent;
@@ -42,10 +42,18 @@
 #include "led.h"
 #include "ledseq.h"
 #include "queuemonitor.h"
+#include "latency.h"
 
 
 #define RADIOLINK_TX_QUEUE_SIZE (1)
 
+// Received packet and the time it was handed over by syslink
+typedef struct
+{
+	CRTPPacket packet;
+	uint32_t timestamp;
+} RadiolinkRxPacket;
+
 static xQueueHandle txQueue;
 static xQueueHandle crtpPacketDelivery;
 
@@ -68,7 +76,7 @@ void radiolinkInit(void) {
 
 	txQueue = xQueueCreate(RADIOLINK_TX_QUEUE_SIZE, sizeof(SyslinkPacket));
 	DEBUG_QUEUE_MONITOR_REGISTER(txQueue);
-	crtpPacketDelivery = xQueueCreate(5, sizeof(CRTPPacket));
+	crtpPacketDelivery = xQueueCreate(5, sizeof(RadiolinkRxPacket));
 	DEBUG_QUEUE_MONITOR_REGISTER(crtpPacketDelivery);
 
 	ASSERT(crtpPacketDelivery);
@@ -115,9 +123,12 @@ void radiolinkSetAddress(uint64_t address) {
 
 void radiolinkSyslinkDispatch(SyslinkPacket *slp) {
 	static SyslinkPacket txPacket;
+	static RadiolinkRxPacket rxPacket;
 	if (slp->type == SYSLINK_RADIO_RAW) {
 		slp->length--; // Decrease to get CRTP size.
-		xQueueSend(crtpPacketDelivery, &slp->length, 0);
+		memcpy(&rxPacket.packet, &slp->length, sizeof(CRTPPacket));
+		rxPacket.timestamp = latencyStamp();
+		xQueueSend(crtpPacketDelivery, &rxPacket, 0);
 		ledseqRun(LINK_LED, seq_linkup);
 		// If a radio packet is received, one can be sent
 		if (xQueueReceive(txQueue, &txPacket, 0) == pdTRUE) {
@@ -131,7 +142,11 @@ void radiolinkSyslinkDispatch(SyslinkPacket *slp) {
 }
 
 static int radiolinkReceiveCRTPPacket(CRTPPacket *p) {
-	if (xQueueReceive(crtpPacketDelivery, p, M2T(100)) == pdTRUE) {
+	static RadiolinkRxPacket rxPacket;
+
+	if (xQueueReceive(crtpPacketDelivery, &rxPacket, M2T(100)) == pdTRUE) {
+		*p = rxPacket.packet;
+		latencyLinkReceived(rxPacket.timestamp);
 		return 0;
 	}
 
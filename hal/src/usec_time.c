@@ -30,6 +30,17 @@
 #include "nvicconf.h"
 #include "stm32fxxx.h"
 
+// TIM1 runs at the core clock on both platforms, prescale it to 1MHz
+#ifdef STM32F4XX
+  #define USEC_TIMER_PRESCALE   (168 - 1)
+  #define USEC_TIMER_IRQn       TIM1_UP_TIM10_IRQn
+  #define USEC_TIMER_IRQHandler TIM1_UP_TIM10_IRQHandler
+#else
+  #define USEC_TIMER_PRESCALE   (72 - 1)
+  #define USEC_TIMER_IRQn       TIM1_UP_IRQn
+  #define USEC_TIMER_IRQHandler TIM1_UP_IRQHandler
+#endif
+
 static uint32_t usecTimerHighCount;
 
 void initUsecTimer(void)
@@ -44,13 +55,13 @@ void initUsecTimer(void)
 
   //Timer configuration
   TIM_TimeBaseStructure.TIM_Period = 0xFFFF;
-  TIM_TimeBaseStructure.TIM_Prescaler = 72;
+  TIM_TimeBaseStructure.TIM_Prescaler = USEC_TIMER_PRESCALE;
   TIM_TimeBaseStructure.TIM_ClockDivision = TIM_CKD_DIV1;
   TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
   TIM_TimeBaseStructure.TIM_RepetitionCounter = 0;
   TIM_TimeBaseInit(TIM1, &TIM_TimeBaseStructure);
 
-  NVIC_InitStructure.NVIC_IRQChannel = TIM1_UP_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannel = USEC_TIMER_IRQn;
   NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = NVIC_TRACE_TIM_PRI;
   NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
   NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
@@ -78,7 +89,7 @@ uint64_t usecTimestamp(void)
   return (((uint64_t)high) << 16) + TIM1->CNT;
 }
 
-void __attribute__((used)) TIM1_UP_IRQHandler(void)
+void __attribute__((used)) USEC_TIMER_IRQHandler(void)
 {
   TIM_ClearITPendingBit(TIM1, TIM_IT_Update);
 
@@ -0,0 +1,127 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * autotune.h - Relay feedback PID autotuner.
+ */
+
+#ifndef __AUTOTUNE_H__
+#define __AUTOTUNE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Relay feedback autotuner.
+ *
+ * While hovering, the output of one PID (rate or attitude loop, one axis) is
+ * replaced by a relay of amplitude d switching on the sign of the control
+ * error. The loop settles in a limit cycle of period Tu and amplitude a,
+ * giving the ultimate gain Ku = 4d / (pi a). PID gains are then suggested
+ * from Ku and Tu.
+ *
+ * The relay itself does not depend on FreeRTOS so that it can be run in a
+ * host simulation of the rate loop.
+ */
+
+/* Number of limit cycles ignored before measuring. */
+#define AUTOTUNE_SETTLE_CYCLES   2
+/* Number of limit cycles averaged for the result. */
+#define AUTOTUNE_MEASURE_CYCLES  4
+
+/* Hard limits on the relay amplitude, the amp param is clamped to these. */
+#define AUTOTUNE_MAX_AMP_RATE      8000.0f  // Actuator units
+#define AUTOTUNE_MAX_AMP_ATTITUDE  120.0f   // deg/s
+
+typedef enum {
+  AUTOTUNE_LOOP_RATE     = 0,
+  AUTOTUNE_LOOP_ATTITUDE = 1,
+} autotuneLoop_t;
+
+typedef enum {
+  AUTOTUNE_AXIS_NONE  = 0,
+  AUTOTUNE_AXIS_ROLL  = 1,
+  AUTOTUNE_AXIS_PITCH = 2,
+  AUTOTUNE_AXIS_YAW   = 3,
+} autotuneAxis_t;
+
+typedef enum {
+  autotuneIdle     = 0,
+  autotuneRunning  = 1,
+  autotuneDone     = 2,
+  autotuneAborted  = 3,
+} autotuneState_t;
+
+/* Relay object. */
+typedef struct {
+  float amplitude;   /* Relay output amplitude. */
+  float hysteresis;  /* Error band in which the relay keeps its output. */
+  float output;      /* Current relay output. */
+  float time;        /* Time since the relay was started in seconds. */
+  float lastSwitch;  /* Time of the last switch to positive output. */
+  float errMax;      /* Error extremes during the current cycle. */
+  float errMin;
+  uint32_t cycles;   /* Number of complete limit cycles. */
+  float periodSum;   /* Sums over the measured cycles. */
+  float ampSum;
+  float ku;          /* Ultimate gain, valid once autotuneRelayIsDone(). */
+  float tu;          /* Ultimate period in seconds. */
+} autotuneRelay_t;
+
+void autotuneRelayInit(autotuneRelay_t *relay, float amplitude, float hysteresis);
+float autotuneRelayUpdate(autotuneRelay_t *relay, float error, float dt);
+bool autotuneRelayIsDone(const autotuneRelay_t *relay);
+void autotuneRelayGetPid(const autotuneRelay_t *relay, float* kp, float* ki, float* kd);
+
+/**
+ * Supervise the autotuner. Starts a requested run when the vehicle is
+ * hovering within the limits and aborts a run that leaves them. Should be
+ * called once per control cycle, before autotuneRun().
+ *
+ * @param allowed False when the relay may not take over the loop, e.g. when
+ *                the PID controller is not the one flying. A request is then
+ *                refused and a run aborted.
+ */
+void autotuneCheckSafety(float roll, float pitch, float rollRate, float pitchRate,
+                         float yawRate, uint16_t thrust, bool allowed);
+
+/**
+ * @return The axis being tuned on 'loop', AUTOTUNE_AXIS_NONE if not running on it.
+ */
+autotuneAxis_t autotuneGetAxis(autotuneLoop_t loop);
+
+/**
+ * Run the relay on the tuned axis. Applies the suggested gains to the
+ * controller when the run completes and the apply param is set.
+ *
+ * @param error Control error of the tuned axis.
+ * @param dt    Time since the last call in seconds.
+ * @return The relay output that replaces the PID output.
+ */
+float autotuneRun(float error, float dt);
+
+/**
+ * Abort a running autotune, the PID outputs are used again from the next cycle.
+ */
+void autotuneAbort(void);
+
+#endif
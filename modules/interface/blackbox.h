@@ -0,0 +1,60 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * blackbox.h - High rate flight recorder in RAM.
+ */
+
+#ifndef __BLACKBOX_H__
+#define __BLACKBOX_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "imu_types.h"
+
+/* Why the recording was frozen. */
+typedef enum {
+  blackboxCauseNone = 0,
+  blackboxCauseCrash,   /* Acceleration above blackbox.crashAcc. */
+  blackboxCauseTumble,  /* Tumble detected by the situation awareness. */
+  blackboxCauseParam,   /* blackbox.trigger written. */
+  blackboxCauseMem,     /* Trigger written to the blackbox memory. */
+} blackboxCause_t;
+
+void blackboxInit(void);
+bool blackboxTest(void);
+
+/**
+ * Record one sample of the configured log variables and check the triggers.
+ * Called by the stabilizer at the end of every control cycle.
+ */
+void blackboxRecord(uint32_t tick, const Axis3f* acc);
+
+/* Freeze the recording once the post-trigger window is filled. */
+void blackboxTrigger(blackboxCause_t cause);
+
+/* Access as a virtual memory through the mem port, see blackbox.c. */
+uint32_t blackboxMemGetSize(void);
+bool blackboxMemRead(uint32_t memAddr, uint8_t readLen, uint8_t *buffer);
+bool blackboxMemWrite(uint32_t memAddr, uint8_t writeLen, const uint8_t *buffer);
+
+#endif /* __BLACKBOX_H__ */
@@ -29,6 +29,7 @@
 #include <stdbool.h>
 #include "config.h"
 #include "crtp.h"
+#include "trajectory.h"
 
 
 #ifdef PLATFORM_CF1
@@ -59,6 +60,15 @@ typedef enum
   XMODE     = 2, // X-mode. M1 & M4 is defined as front
 } YawModeType;
 
+/**
+ * Position estimate in meters, trilaterated from the neighbours.
+ */
+typedef struct
+{
+  float x, y, z;
+  uint32_t timestamp; // Tick of the estimate
+} positionEstimate_t;
+
 void commanderAdvancedInit(void);
 bool commanderAdvancedTest(void);
 void commanderAdvancedWatchdog(void);
@@ -73,5 +83,13 @@ bool commanderAdvancedGetAltHoldMode(void);
 void commanderAdvancedSetAltHoldMode(bool altHoldModeNew);
 YawModeType commanderAdvancedGetYawMode(void);
 bool commanderAdvancedGetYawModeCarefreeResetFront(void);
+/**
+ * @return true and the latest position estimate if one newer than 500ms exists.
+ */
+bool commanderAdvancedGetPositionEstimate(positionEstimate_t* estimate);
+/**
+ * @return true and the position setpoint from the ground if one is active.
+ */
+bool commanderAdvancedGetPositionSetpoint(trajectoryPoint_t* setpoint);
 
 #endif /* COMMANDER_H_ */
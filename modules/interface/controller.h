@@ -29,10 +29,81 @@
 #include <stdbool.h>
 #include "commanderadvanced.h"
 
+/**
+ * Controller ids, the value of the controller.type param that selects them.
+ */
+typedef enum
+{
+  CONTROLLER_PID  = 0,
+  CONTROLLER_INDI = 1,
+  CONTROLLER_LQR  = 2,
+} ControllerType;
+
+/* Structure definition and registering macro */
+typedef struct controller_s {
+  uint8_t id;
+  const char *name;
+
+  /* Init and test functions */
+  void (*init)(void);
+  bool (*test)(void);
+
+  /* Reset the state so that the next output continues from the given
+   * actuator output. Called with zeros while landed. */
+  void (*reset)(int16_t roll, int16_t pitch, int16_t yaw);
+
+  /* Attitude update, run at the attitude rate. Outputs the desired rates.
+   * Controllers that only replace the rate loop leave it NULL and the
+   * attitude PIDs are used. */
+  void (*updateAttitude)(float eulerRollActual, float eulerPitchActual, float eulerYawActual,
+                         float eulerRollDesired, float eulerPitchDesired, float eulerYawDesired,
+                         float* rollRateDesired, float* pitchRateDesired, float* yawRateDesired);
+
+  /* Rate update, run at IMU_UPDATE_FREQ. Outputs the actuator commands. */
+  void (*updateRate)(float rollRateActual, float pitchRateActual, float yawRateActual,
+                     float rollRateDesired, float pitchRateDesired, float yawRateDesired,
+                     int16_t* roll, int16_t* pitch, int16_t* yaw);
+} Controller;
+
+#define CONTROLLER(NAME) const struct controller_s * controller_##NAME __attribute__((section(".controller." #NAME), used)) = &(NAME)
 
 void controllerInit(void);
 bool controllerTest(void);
 
+/**
+ * Update the rate and attitude PID gains from the gain schedule for the
+ * given thrust. Only the gains are changed, integrators are kept. Should be
+ * run once per attitude update.
+ */
+void controllerScheduleGains(uint16_t thrust);
+
+/**
+ * Set the base gains of a rate (rateLoop = true) or attitude PID. The gains
+ * are applied at the next controllerScheduleGains().
+ *
+ * @param axis 0 = roll, 1 = pitch, 2 = yaw.
+ */
+void controllerSetBaseGains(bool rateLoop, int axis, float kp, float ki, float kd);
+
+/**
+ * Select the controller, same as setting the controller.type param. The
+ * switch happens at the next controllerUpdateSelection().
+ */
+void controllerSetType(ControllerType type);
+
+/**
+ * @return The controller that is flying, which can lag the selected one
+ * until controllerUpdateSelection().
+ */
+ControllerType controllerGetType(void);
+
+/**
+ * Switch to the selected controller if it changed. The new controller
+ * continues from the current actuator output. Should only be called while
+ * landed.
+ */
+void controllerUpdateSelection(void);
+
 /**
  * Make the controller run an update of the attitude PID. The output is
  * the desired rate which should be fed into a rate controller. The
@@ -45,15 +116,16 @@ void controllerCorrectAttitudePID(
        float* rollRateDesired, float* pitchRateDesired, float* yawRateDesired);
 
 /**
- * Make the controller run an update of the rate PID. The output is
- * the actuator force.
+ * Make the controller run an update of the rate loop of the active
+ * controller. The output is the actuator force.
  */
 void controllerCorrectRatePID(
        float rollRateActual, float pitchRateActual, float yawRateActual,
        float rollRateDesired, float pitchRateDesired, float yawRateDesired);
 
 /**
- * Reset controller roll, pitch and yaw PID's.
+ * Reset controller roll, pitch and yaw PID's and the state of the active
+ * controller.
  */
 void controllerResetAllPID(void);
 
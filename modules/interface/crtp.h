@@ -42,6 +42,7 @@ typedef enum {
   CRTP_PORT_COMMANDER   		= 0x03,
   CRTP_PORT_MEM         		= 0x04,
   CRTP_PORT_LOG         		= 0x05,
+  CRTP_PORT_TRAJECTORY  		= 0x08,
   CRTP_PORT_COMMANDER_ADVANCED  = 0x0A,
   CRTP_PORT_PLATFORM    		= 0x0D,
   CRTP_PORT_LINK        		= 0x0F,
@@ -0,0 +1,66 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * indicontroller.h - INDI rate controller
+ */
+
+#ifndef INDICONTROLLER_H_
+#define INDICONTROLLER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Incremental nonlinear dynamic inversion (INDI) rate controller.
+ *
+ * Instead of integrating the rate error the controller measures the angular
+ * acceleration from the filtered gyro and changes the previous actuator
+ * command by the amount needed to reach the desired angular acceleration:
+ *
+ *   u = u0 + (nu - omegaDot) / g
+ *
+ * where u0 is the previous command through the same filter as the gyro,
+ * nu = k * (rateDesired - rate) and g is the control effectiveness in
+ * deg/s^2 per actuator unit. Disturbances show up in omegaDot and are
+ * rejected within one filter delay.
+ */
+
+void indiControllerInit(void);
+bool indiControllerTest(void);
+
+/**
+ * Run one update of the INDI rate controller. Rates in deg/s, outputs in
+ * the same units as the rate PID outputs. Should be called at IMU_UPDATE_FREQ.
+ */
+void indiControllerUpdate(
+       float rollRateActual, float pitchRateActual, float yawRateActual,
+       float rollRateDesired, float pitchRateDesired, float yawRateDesired,
+       int16_t* roll, int16_t* pitch, int16_t* yaw);
+
+/**
+ * Reset the filters and set the previous command. Used to start bumplessly
+ * from the output of another rate controller.
+ */
+void indiControllerReset(int16_t roll, int16_t pitch, int16_t yaw);
+
+#endif /* INDICONTROLLER_H_ */
@@ -0,0 +1,77 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * latency.h - Tracing of the setpoint latency from radio to motors.
+ */
+
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "crtp.h"
+#include "usec_time.h"
+
+/* Points along the command path where a setpoint is stamped. */
+typedef enum {
+  latencyLinkRx = 0, /* Received from the radio by the link layer. */
+  latencyCrtpRx,     /* Dispatched by the CRTP RX task. */
+  latencyPublish,    /* Published to the stabilizer by the commander. */
+  latencyFetch,      /* Picked up by the stabilizer. */
+  latencyMotors,     /* Applied to the motors. */
+  latencyPointCount,
+} latencyPoint_t;
+
+/**
+ * Trace of one setpoint, carried along with it.
+ *
+ * Stamps are the low 32 bits of usecTimestamp(), 0 for a point the setpoint
+ * did not pass (e.g. no link stamp for packets received over USB).
+ */
+typedef struct {
+  uint32_t stamp[latencyPointCount];
+  uint32_t tag; /* Ground station tag, echoed back in loopback mode. */
+} latencyTrace_t;
+
+/* CRTP link channel the loopback echo is sent on, next to echo/source/sink. */
+#define LATENCY_LOOPBACK_CHANNEL 3
+
+/* Called from the CRTP RX task, for one packet at a time. */
+void latencyLinkReceived(uint32_t stamp);
+void latencyCrtpDispatched(void);
+/**
+ * Start the trace of a setpoint received in packet pk. The ground station
+ * can append a 32 bit tag to the packet at tagOffset.
+ */
+void latencyCapture(latencyTrace_t *trace, const CRTPPacket *pk, uint8_t tagOffset);
+
+/* Called from the stabilizer task. */
+void latencyFetched(const latencyTrace_t *trace);
+void latencyMotorsUpdated(void);
+
+static inline uint32_t latencyStamp(void)
+{
+  return (uint32_t)usecTimestamp();
+}
+
+#endif
@@ -34,12 +34,30 @@
 void logInit(void);
 bool logTest(void);
 
+/**
+ * Lower the rate of all running log blocks. Only every divider:th timer
+ * expiry of a block sends a packet, 1 gives the requested rate.
+ */
+void logSetRateDivider(uint8_t divider);
+
+/**
+ * Advance the log scheduler to tick. Called by the control loop every cycle
+ * so that log blocks are sampled in step with it, down to a 2ms period.
+ */
+void logSchedulerTick(uint32_t tick);
+
 /* Internal access of log variables */
 int logGetVarId(char* group, char* name);
 float logGetFloat(int varid);
 int logGetInt(int varid);
 unsigned int logGetUint(int varid);
 
+/* Direct access for modules sampling variables themselves. tocId is the id
+ * used by the log TOC, the returned varid is usable with the getters. */
+int logGetVarIdFromToc(int tocId);
+int logGetType(int varid);
+void* logGetAddress(int varid);
+
 /* Basic log structure */
 struct log_s {
   uint8_t type;
@@ -0,0 +1,69 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * lqrcontroller.h - LQR attitude controller
+ */
+
+#ifndef LQRCONTROLLER_H_
+#define LQRCONTROLLER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LQR_INPUTS  3   // Roll, pitch and yaw actuator commands
+#define LQR_STATES  9   // Attitude error integral, attitude error and rate error per axis
+
+/**
+ * Full state LQR attitude controller. The actuator commands are one 3x9
+ * matrix-vector product of the gain matrix with the state
+ *
+ *   [integral of attitude error, attitude error, rate error]
+ *
+ * so coupling between the axes in the vehicle model is accounted for. The
+ * gains are computed offline by tools/lqr/lqrgains.py, the defaults are in
+ * lqrgains.h and they can be changed through the lqr params.
+ */
+
+void lqrControllerInit(void);
+bool lqrControllerTest(void);
+
+/**
+ * Set the attitude error (desired - actual, in deg) used by the next updates.
+ * Can be called at a lower rate than lqrControllerUpdate().
+ */
+void lqrControllerSetAttitudeError(float roll, float pitch, float yaw);
+
+/**
+ * Run one update of the controller. Rate errors (desired - actual) are in
+ * deg/s. Should be called at IMU_UPDATE_FREQ, the rate the gains are
+ * computed for.
+ */
+void lqrControllerUpdate(float rollRateError, float pitchRateError, float yawRateError,
+                         int16_t* roll, int16_t* pitch, int16_t* yaw);
+
+/**
+ * Reset the integral states.
+ */
+void lqrControllerReset(void);
+
+#endif /* LQRCONTROLLER_H_ */
@@ -0,0 +1,16 @@
+/* This file is automatically generated by tools/lqr/lqrgains.py!
+ * Do not edit manually, any manual change will be overwritten.
+ *
+ * lqrgains.py --output ../../modules/interface/lqrgains.h
+ */
+#ifndef LQRGAINS_H_
+#define LQRGAINS_H_
+
+/* Converged after 20275 iterations. */
+#define LQR_GAINS { \
+  { 175.704f, 0.238411f, -0.355999f, 578.336f, 1.01374f, -1.95008f, 73.2848f, 0.853737f, 0.00864257f }, \
+  { 0.244967f, 175.678f, -0.903639f, 1.03525f, 578.27f, -4.95072f, 0.856211f, 73.3364f, 0.0171127f }, \
+  { 1.26805f, 3.24933f, 57.1268f, 4.52718f, 11.5836f, 330.218f, 1.71455f, 4.33512f, 97.5025f }, \
+}
+
+#endif /* LQRGAINS_H_ */
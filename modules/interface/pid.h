@@ -28,6 +28,7 @@
 #define PID_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #define PID_ROLL_RATE_KP  70.0
 #define PID_ROLL_RATE_KI  0.0
@@ -100,6 +101,14 @@ void pidInit(PidObject* pid, const float desired, const float kp,
  */
 void pidSetIntegralLimit(PidObject* pid, const float limit);
 
+/**
+ * Set the lower integral limit for this PID.
+ *
+ * @param[in] pid      A pointer to the pid object.
+ * @param[in] limitLow Pid integral lower swing limit.
+ */
+void pidSetIntegralLimitLow(PidObject* pid, const float limitLow);
+
 /**
  * Reset the PID error values
  *
@@ -178,4 +187,51 @@ void pidSetKd(PidObject* pid, const float kd);
  * @param[in] dt    Delta time
  */
 void pidSetDt(PidObject* pid, const float dt);
+
+/**
+ * Fixed point PID, for targets without FPU. Values are in Q16 (the same
+ * units as PidObject scaled by 2^16), dt is kept in Q30.
+ */
+typedef struct
+{
+  int32_t desired;    //< set point
+  int32_t error;      //< error
+  int32_t prevError;  //< previous error
+  int32_t integ;      //< integral
+  int32_t kp;         //< proportional gain
+  int32_t ki;         //< integral gain
+  int32_t kd;         //< derivative gain
+  int32_t iLimit;     //< integral limit
+  int32_t iLimitLow;  //< integral limit
+  int32_t dt;         //< delta-time dt, Q30
+  int32_t invDt;      //< 1 / dt
+} PidFixObject;
+
+/**
+ * Fixed point PID object initialization, see pidInit().
+ */
+void pidFixInit(PidFixObject* pid, const float desired, const float kp,
+                const float ki, const float kd, const float dt);
+
+void pidFixSetIntegralLimit(PidFixObject* pid, const float limit);
+
+void pidFixReset(PidFixObject* pid);
+
+/**
+ * Update the fixed point PID, see pidUpdate().
+ *
+ * @param[in] measured The measured value in Q16.
+ * @return PID algorithm output in Q16, saturated to the int32 range.
+ */
+int32_t pidFixUpdate(PidFixObject* pid, const int32_t measured, const bool updateError);
+
+void pidFixSetDesired(PidFixObject* pid, const int32_t desired);
+
+void pidFixSetError(PidFixObject* pid, const int32_t error);
+
+void pidFixSetKp(PidFixObject* pid, const float kp);
+
+void pidFixSetKi(PidFixObject* pid, const float ki);
+
+void pidFixSetKd(PidFixObject* pid, const float kd);
 #endif /* PID_H_ */
@@ -0,0 +1,76 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * positioncontroller.h - Cascaded position/velocity controller
+ */
+
+#ifndef POSITIONCONTROLLER_H_
+#define POSITIONCONTROLLER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "commanderadvanced.h"
+#include "trajectory.h"
+
+/**
+ * Cascaded position controller. Position errors give a velocity setpoint,
+ * with feed-forward of the setpoint velocity. Velocity errors give a world
+ * frame acceleration, which is turned into roll, pitch and thrust setpoints
+ * for the attitude controller. The cost of one update is constant.
+ */
+
+void positionControllerInit(void);
+bool positionControllerTest(void);
+
+/**
+ * @return true if position control is enabled by the posCtrl.enable param.
+ */
+bool positionControllerIsEnabled(void);
+
+/**
+ * @return The divider of the stabilizer rate the controller should run at.
+ */
+uint32_t positionControllerGetRateDivider(void);
+
+/**
+ * Run one position controller update.
+ *
+ * @param estimate Current position estimate.
+ * @param setpoint Position setpoint, the velocity is used as feed-forward.
+ * @param yaw      Current yaw in degrees, used to rotate into the body frame.
+ * @param dt       Time since the last update in seconds.
+ * @param roll     Roll setpoint in degrees, positive accelerates along body -y.
+ * @param pitch    Pitch setpoint in degrees, positive accelerates along body x.
+ * @param thrust   Thrust setpoint.
+ */
+void positionControllerUpdate(const positionEstimate_t* estimate, const trajectoryPoint_t* setpoint,
+                              float yaw, float dt, float* roll, float* pitch, uint16_t* thrust);
+
+/**
+ * Reset the integrators and the velocity estimate. Should be called while
+ * position control is not active.
+ */
+void positionControllerReset(void);
+
+#endif /* POSITIONCONTROLLER_H_ */
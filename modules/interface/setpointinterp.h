@@ -0,0 +1,64 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * setpointinterp.h - Interpolation of setpoints between commander packets.
+ */
+
+#ifndef __SETPOINTINTERP_H__
+#define __SETPOINTINTERP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Setpoint interpolation mode. */
+typedef enum {
+  setpointInterpOff         = 0, /* Use the latest setpoint as is. */
+  setpointInterpInterpolate = 1, /* Ramp from the previous to the latest setpoint over one packet interval. */
+  setpointInterpExtrapolate = 2, /* Continue the trend of the two latest setpoints, up to the horizon. */
+} setpointInterpMode_t;
+
+/**
+ * Setpoint interpolation object.
+ *
+ * Keeps the arrival time of the two latest setpoints. The setpoint values
+ * themselves stay with the owner (e.g. the commander double buffer).
+ */
+typedef struct {
+  uint32_t prevTime;   /* Arrival time in ticks of the previous setpoint. */
+  uint32_t latestTime; /* Arrival time in ticks of the latest setpoint. */
+} setpointInterp_t;
+
+void setpointInterpInit(setpointInterp_t *interp, uint32_t timestamp);
+void setpointInterpNewSample(setpointInterp_t *interp, uint32_t timestamp);
+float setpointInterpGetFactor(const setpointInterp_t *interp, uint32_t now);
+
+/**
+ * Blend the previous and latest setpoint value with a factor from
+ * setpointInterpGetFactor(). A factor of 1 gives the latest value.
+ */
+static inline float setpointInterpApply(float prev, float latest, float factor)
+{
+  return prev + (latest - prev) * factor;
+}
+
+#endif
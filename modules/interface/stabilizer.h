@@ -27,10 +27,39 @@
 #define STABALIZER_H_
 
 #include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Vehicle state published by the stabilizer once per cycle.
+ */
+typedef struct
+{
+  uint32_t timestamp;     // Tick of the stabilizer cycle
+  float roll;             // deg, same as the stabilizer.roll log
+  float pitch;            // deg
+  float yaw;              // deg
+  float rollRate;         // Gyro deg/s
+  float pitchRate;
+  float yawRate;
+  float accX;             // Accelerometer in G
+  float accY;
+  float accZ;
+  float accZWorld;        // Vertical acceleration without gravity, in G
+  float asl;              // Smoothed barometer altitude, m
+  float altitude;         // Altitude estimate used by altitude hold, m
+  uint16_t thrust;        // Thrust setpoint
+  uint16_t motors[4];     // Motor outputs M1-M4
+} vehicleState_t;
 
 void stabilizerInit(void);
 
 bool stabilizerTest(void);
 
+/**
+ * Copy the last published vehicle state. Lock free and consistent, the
+ * copy is never a mix of two cycles. Can be called from any task.
+ */
+void stabilizerGetState(vehicleState_t* state);
+
 
 #endif /* STABALIZER_H_ */
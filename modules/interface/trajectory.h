@@ -0,0 +1,96 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * trajectory.h - Onboard piecewise polynomial trajectories.
+ */
+
+#ifndef __TRAJECTORY_H__
+#define __TRAJECTORY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Trajectory memory size in bytes. The memory is uploaded through the mem
+ * port as an array of trajectoryPoly4d_t pieces.
+ */
+#ifdef PLATFORM_CF1
+  #define TRAJECTORY_MEM_SIZE   (4 * sizeof(trajectoryPoly4d_t))
+#else
+  #define TRAJECTORY_MEM_SIZE   (31 * sizeof(trajectoryPoly4d_t))
+#endif
+
+/* Number of polynomial coefficients per axis (degree 7). */
+#define TRAJECTORY_POLY_COEFFS  8
+
+/* Polynomial axis index. */
+#define TRAJECTORY_X    0
+#define TRAJECTORY_Y    1
+#define TRAJECTORY_Z    2
+#define TRAJECTORY_YAW  3
+
+/**
+ * One piece of the trajectory. Each axis is a polynomial in the time since
+ * the start of the piece, lowest order coefficient first. Positions are in
+ * meters, yaw in degrees and the duration in seconds. Only floats, so the
+ * layout has no padding and matches the uploaded data.
+ */
+typedef struct {
+  float p[4][TRAJECTORY_POLY_COEFFS];
+  float duration;
+} trajectoryPoly4d_t;
+
+/* Evaluated trajectory setpoint. */
+typedef struct {
+  float x, y, z;       /* Position in meters */
+  float vx, vy, vz;    /* Velocity in meters/second */
+  float yaw;           /* Yaw in degrees */
+} trajectoryPoint_t;
+
+void trajectoryInit(void);
+bool trajectoryTest(void);
+
+/**
+ * Start running 'nPieces' pieces from 'startPiece' after 'delayMs'.
+ * Normally triggered by the start command on CRTP_PORT_TRAJECTORY.
+ *
+ * @return 0 on success, an errno value otherwise.
+ */
+int trajectoryStart(uint8_t startPiece, uint8_t nPieces, uint16_t delayMs);
+void trajectoryStop(void);
+bool trajectoryIsRunning(void);
+
+/**
+ * Sample the trajectory at time 'tick'. Should be called at the control rate.
+ * Once the last piece has ended the final point is held.
+ *
+ * @return true if 'point' holds a valid setpoint, false if no trajectory is active.
+ */
+bool trajectoryEvaluate(uint32_t tick, trajectoryPoint_t *point);
+
+/* Mem port access to the trajectory memory. */
+uint32_t trajectoryMemGetSize(void);
+bool trajectoryMemRead(uint32_t memAddr, uint8_t readLen, uint8_t *buffer);
+bool trajectoryMemWrite(uint32_t memAddr, uint8_t writeLen, const uint8_t *buffer);
+
+#endif
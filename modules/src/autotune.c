@@ -0,0 +1,241 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * autotune.c - Relay feedback PID autotuner.
+ */
+
+#include <math.h>
+
+#include "autotune.h"
+#include "controller.h"
+#include "param.h"
+#include "log.h"
+
+/* Autotune params. Setting start to 1 requests a run of 'loop' on 'axis'. */
+static uint8_t tuneAxis = AUTOTUNE_AXIS_NONE;
+static uint8_t tuneLoop = AUTOTUNE_LOOP_RATE;
+static uint8_t tuneStart = 0;
+static uint8_t tuneApply = 0;
+static float tuneAmp = 2000.0f;        // Relay amplitude (actuator units or deg/s)
+static float tuneHysteresis = 2.0f;    // deg/s or deg
+static float tuneMaxTime = 10.0f;      // Maximum run time in seconds
+static float tuneMaxAngle = 20.0f;     // Max roll/pitch angle in deg
+static float tuneMaxRate = 400.0f;     // Max body rate in deg/s
+static uint16_t tuneMinThrust = 20000; // Must be hovering
+
+/* Autotune results. */
+static uint8_t state = autotuneIdle;
+static uint8_t runAxis = AUTOTUNE_AXIS_NONE;
+static uint8_t runLoop = AUTOTUNE_LOOP_RATE;
+static float resultKp;
+static float resultKi;
+static float resultKd;
+
+static autotuneRelay_t relay;
+
+/**
+ * Initialize a relay object.
+ *
+ * @param relay      The relay object.
+ * @param amplitude  Relay output amplitude.
+ * @param hysteresis Error band in which the relay does not switch.
+ */
+void autotuneRelayInit(autotuneRelay_t *relay, float amplitude, float hysteresis)
+{
+  relay->amplitude = amplitude;
+  relay->hysteresis = hysteresis;
+  relay->output = amplitude;
+  relay->time = 0;
+  relay->lastSwitch = -1.0f;
+  relay->errMax = -INFINITY;
+  relay->errMin = INFINITY;
+  relay->cycles = 0;
+  relay->periodSum = 0;
+  relay->ampSum = 0;
+  relay->ku = 0;
+  relay->tu = 0;
+}
+
+/**
+ * Run one relay step and measure the limit cycle.
+ *
+ * @param relay The relay object.
+ * @param error Control error (desired - measured).
+ * @param dt    Time since the last call in seconds.
+ *
+ * @return The relay output.
+ */
+float autotuneRelayUpdate(autotuneRelay_t *relay, float error, float dt)
+{
+  relay->time += dt;
+
+  if (error > relay->errMax)
+    relay->errMax = error;
+  if (error < relay->errMin)
+    relay->errMin = error;
+
+  if (error < -relay->hysteresis && relay->output > 0)
+  {
+    relay->output = -relay->amplitude;
+  }
+  else if (error > relay->hysteresis && relay->output < 0)
+  {
+    // One full limit cycle ends at every switch to positive output
+    relay->output = relay->amplitude;
+
+    if (relay->lastSwitch >= 0)
+    {
+      relay->cycles++;
+      if (relay->cycles > AUTOTUNE_SETTLE_CYCLES &&
+          relay->cycles <= AUTOTUNE_SETTLE_CYCLES + AUTOTUNE_MEASURE_CYCLES)
+      {
+        relay->periodSum += relay->time - relay->lastSwitch;
+        relay->ampSum += (relay->errMax - relay->errMin) / 2;
+      }
+      if (relay->cycles == AUTOTUNE_SETTLE_CYCLES + AUTOTUNE_MEASURE_CYCLES)
+      {
+        float a = relay->ampSum / AUTOTUNE_MEASURE_CYCLES;
+
+        relay->tu = relay->periodSum / AUTOTUNE_MEASURE_CYCLES;
+        relay->ku = (a > 0) ? (4 * relay->amplitude) / ((float)M_PI * a) : 0;
+      }
+    }
+    relay->lastSwitch = relay->time;
+    relay->errMax = error;
+    relay->errMin = error;
+  }
+
+  return relay->output;
+}
+
+bool autotuneRelayIsDone(const autotuneRelay_t *relay)
+{
+  return relay->cycles >= AUTOTUNE_SETTLE_CYCLES + AUTOTUNE_MEASURE_CYCLES;
+}
+
+/**
+ * Suggest PID gains from the measured limit cycle. Uses the Ziegler-Nichols
+ * "some overshoot" rule, which is less aggressive than the classic one.
+ */
+void autotuneRelayGetPid(const autotuneRelay_t *relay, float* kp, float* ki, float* kd)
+{
+  *kp = 0.33f * relay->ku;
+  *ki = (relay->tu > 0) ? 2.0f * *kp / relay->tu : 0;
+  *kd = *kp * relay->tu / 3.0f;
+}
+
+static float autotuneMaxAmp(autotuneLoop_t loop)
+{
+  return (loop == AUTOTUNE_LOOP_RATE) ? AUTOTUNE_MAX_AMP_RATE : AUTOTUNE_MAX_AMP_ATTITUDE;
+}
+
+void autotuneCheckSafety(float roll, float pitch, float rollRate, float pitchRate,
+                         float yawRate, uint16_t thrust, bool allowed)
+{
+  bool withinLimits = allowed && (thrust >= tuneMinThrust) &&
+                      (fabsf(roll) < tuneMaxAngle) && (fabsf(pitch) < tuneMaxAngle) &&
+                      (fabsf(rollRate) < tuneMaxRate) && (fabsf(pitchRate) < tuneMaxRate) &&
+                      (fabsf(yawRate) < tuneMaxRate);
+
+  if (tuneStart)
+  {
+    tuneStart = 0;
+
+    if (withinLimits && tuneAxis != AUTOTUNE_AXIS_NONE && tuneAxis <= AUTOTUNE_AXIS_YAW &&
+        (tuneLoop == AUTOTUNE_LOOP_RATE || tuneLoop == AUTOTUNE_LOOP_ATTITUDE))
+    {
+      float amp = fminf(fabsf(tuneAmp), autotuneMaxAmp(tuneLoop));
+
+      runAxis = tuneAxis;
+      runLoop = tuneLoop;
+      autotuneRelayInit(&relay, amp, tuneHysteresis);
+      state = autotuneRunning;
+    }
+    else
+    {
+      state = autotuneAborted;
+    }
+  }
+  else if (state == autotuneRunning && (!withinLimits || relay.time > tuneMaxTime))
+  {
+    state = autotuneAborted;
+  }
+}
+
+autotuneAxis_t autotuneGetAxis(autotuneLoop_t loop)
+{
+  if (state != autotuneRunning || runLoop != loop)
+    return AUTOTUNE_AXIS_NONE;
+
+  return runAxis;
+}
+
+float autotuneRun(float error, float dt)
+{
+  float output = autotuneRelayUpdate(&relay, error, dt);
+
+  if (autotuneRelayIsDone(&relay))
+  {
+    autotuneRelayGetPid(&relay, &resultKp, &resultKi, &resultKd);
+    state = autotuneDone;
+
+    if (tuneApply)
+    {
+      controllerSetBaseGains(runLoop == AUTOTUNE_LOOP_RATE, runAxis - AUTOTUNE_AXIS_ROLL,
+                             resultKp, resultKi, resultKd);
+    }
+  }
+
+  return output;
+}
+
+void autotuneAbort(void)
+{
+  if (state == autotuneRunning)
+  {
+    state = autotuneAborted;
+  }
+}
+
+PARAM_GROUP_START(autotune)
+PARAM_ADD(PARAM_UINT8, axis, &tuneAxis)
+PARAM_ADD(PARAM_UINT8, loop, &tuneLoop)
+PARAM_ADD(PARAM_UINT8, start, &tuneStart)
+PARAM_ADD(PARAM_UINT8, apply, &tuneApply)
+PARAM_ADD(PARAM_FLOAT, amp, &tuneAmp)
+PARAM_ADD(PARAM_FLOAT, hyst, &tuneHysteresis)
+PARAM_ADD(PARAM_FLOAT, maxTime, &tuneMaxTime)
+PARAM_ADD(PARAM_FLOAT, maxAngle, &tuneMaxAngle)
+PARAM_ADD(PARAM_FLOAT, maxRate, &tuneMaxRate)
+PARAM_ADD(PARAM_UINT16, minThrust, &tuneMinThrust)
+PARAM_ADD(PARAM_FLOAT | PARAM_RONLY, kp, &resultKp)
+PARAM_ADD(PARAM_FLOAT | PARAM_RONLY, ki, &resultKi)
+PARAM_ADD(PARAM_FLOAT | PARAM_RONLY, kd, &resultKd)
+PARAM_GROUP_STOP(autotune)
+
+LOG_GROUP_START(autotune)
+LOG_ADD(LOG_UINT8, state, &state)
+LOG_ADD(LOG_FLOAT, out, &relay.output)
+LOG_ADD(LOG_FLOAT, ku, &relay.ku)
+LOG_ADD(LOG_FLOAT, tu, &relay.tu)
+LOG_GROUP_STOP(autotune)
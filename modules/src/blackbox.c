@@ -0,0 +1,373 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * blackbox.c - High rate flight recorder in RAM.
+ */
+#include <string.h>
+
+#include "blackbox.h"
+#include "crtp.h"
+#include "log.h"
+#include "param.h"
+#include "sitaw.h"
+
+/**
+ * The black box continuously records a set of log variables every control
+ * cycle into a RAM ring buffer. When triggered it keeps recording for a post
+ * trigger window and then freezes, so that the buffer holds what happened
+ * around the event until it is downloaded and rearmed.
+ *
+ * The frozen recording is read through the mem port as a virtual memory:
+ * a blackboxHeader_t followed by the records in chronological order. Each
+ * record is the low 16 bits of the tick (ms) followed by the raw value of
+ * each variable, in the order and with the types given by the header.
+ * Writing 0 to address 0 of the memory rearms, any other value triggers.
+ */
+
+#define BLACKBOX_MAX_VARS 8
+#define BLACKBOX_UNUSED   0xFFFF
+#define BLACKBOX_MAGIC    0xBB01
+
+#ifdef PLATFORM_CF1
+  #define BLACKBOX_SIZE    1024
+  #define BLACKBOX_SECTION
+#else
+  // The CCM is not reachable by DMA and otherwise unused, it fits the buffer
+  // without taking from the main RAM.
+  #define BLACKBOX_SIZE    (60 * 1024)
+  #define BLACKBOX_SECTION __attribute__((section(".ccmbss")))
+#endif
+
+typedef enum {
+  blackboxIdle = 0,   /* No variable configured. */
+  blackboxRecording,
+  blackboxTriggered,  /* Recording the post trigger window. */
+  blackboxFrozen,
+} blackboxState_t;
+
+typedef struct {
+  uint16_t magic;
+  uint8_t  cause;        /* blackboxCause_t */
+  uint8_t  nbrVars;
+  uint8_t  recordSize;   /* Bytes per record, stamp included */
+  uint8_t  reserved;
+  uint16_t count;        /* Records in the image */
+  uint16_t triggerIndex; /* Record of the trigger in the image */
+  uint32_t triggerTick;
+  uint16_t tocId[BLACKBOX_MAX_VARS];
+  uint8_t  type[BLACKBOX_MAX_VARS];
+} __attribute__((packed)) blackboxHeader_t;
+
+static const uint8_t typeLength[] = {
+  [LOG_UINT8]  = 1,
+  [LOG_UINT16] = 2,
+  [LOG_UINT32] = 4,
+  [LOG_INT8]   = 1,
+  [LOG_INT16]  = 2,
+  [LOG_INT32]  = 4,
+  [LOG_FLOAT]  = 4,
+};
+
+static uint8_t ring[BLACKBOX_SIZE] BLACKBOX_SECTION;
+static blackboxHeader_t header;
+
+// Configuration, written by the param port
+static uint16_t varTocId[BLACKBOX_MAX_VARS] = {
+  BLACKBOX_UNUSED, BLACKBOX_UNUSED, BLACKBOX_UNUSED, BLACKBOX_UNUSED,
+  BLACKBOX_UNUSED, BLACKBOX_UNUSED, BLACKBOX_UNUSED, BLACKBOX_UNUSED,
+};
+static float crashAcc = 4.0;  // G, 0 disables
+static uint8_t postPercent = 25;
+static uint8_t triggerParam;
+static uint8_t rearm;
+
+// Stabilizer task side
+static uint16_t activeTocId[BLACKBOX_MAX_VARS];
+static void * varAddress[BLACKBOX_MAX_VARS];
+static uint8_t varLength[BLACKBOX_MAX_VARS];
+static uint16_t capacity;      // Records fitting in the ring
+static uint16_t head;          // Next record written
+static uint16_t count;
+static uint16_t oldest;        // First record of the image once frozen
+static uint16_t triggerHead;
+static uint16_t postRemaining;
+static volatile uint8_t state;
+
+// Set by the mem task
+static volatile uint8_t pendingCause;
+static volatile bool pendingRearm;
+
+static bool isInit;
+
+static void blackboxConfigure(void)
+{
+  int i;
+  int varid;
+  int type;
+  uint8_t n = 0;
+  uint8_t recordSize = sizeof(uint16_t);
+
+  state = blackboxIdle;
+
+  for (i = 0; i < BLACKBOX_MAX_VARS; i++)
+  {
+    activeTocId[i] = varTocId[i];
+    header.tocId[i] = BLACKBOX_UNUSED;
+    header.type[i] = 0;
+
+    if (varTocId[i] == BLACKBOX_UNUSED)
+      continue;
+
+    varid = logGetVarIdFromToc(varTocId[i]);
+    if (varid < 0)
+      continue;
+
+    type = logGetType(varid);
+    if (type < LOG_UINT8 || type > LOG_FLOAT)
+      continue;
+
+    header.tocId[n] = varTocId[i];
+    header.type[n] = type;
+    varAddress[n] = logGetAddress(varid);
+    varLength[n] = typeLength[type];
+    recordSize += varLength[n];
+    n++;
+  }
+
+  header.magic = BLACKBOX_MAGIC;
+  header.cause = blackboxCauseNone;
+  header.nbrVars = n;
+  header.recordSize = recordSize;
+  header.count = 0;
+  header.triggerIndex = 0;
+  header.triggerTick = 0;
+
+  capacity = BLACKBOX_SIZE / recordSize;
+  head = 0;
+  count = 0;
+  pendingCause = blackboxCauseNone;
+  triggerParam = 0;
+
+  if (n > 0)
+    state = blackboxRecording;
+}
+
+static void blackboxFreeze(void)
+{
+  oldest = (count < capacity) ? 0 : head;
+  header.count = count;
+  header.triggerIndex = (triggerHead + capacity - oldest) % capacity;
+  state = blackboxFrozen;
+}
+
+static blackboxCause_t blackboxCheckTriggers(const Axis3f* acc)
+{
+  blackboxCause_t cause = blackboxCauseNone;
+
+  if (triggerParam)
+  {
+    triggerParam = 0;
+    cause = blackboxCauseParam;
+  }
+  else if (pendingCause != blackboxCauseNone)
+  {
+    cause = pendingCause;
+  }
+  else if (crashAcc > 0 &&
+           (acc->x*acc->x + acc->y*acc->y + acc->z*acc->z) > crashAcc*crashAcc)
+  {
+    cause = blackboxCauseCrash;
+  }
+#if defined(SITAW_ENABLED)
+  else if (sitAwTuDetected())
+  {
+    cause = blackboxCauseTumble;
+  }
+#endif
+
+  pendingCause = blackboxCauseNone;
+
+  return cause;
+}
+
+void blackboxInit(void)
+{
+  if (isInit)
+    return;
+
+  blackboxConfigure();
+
+  isInit = true;
+}
+
+bool blackboxTest(void)
+{
+  return isInit;
+}
+
+void blackboxRecord(uint32_t tick, const Axis3f* acc)
+{
+  blackboxCause_t cause = blackboxCauseNone;
+  uint8_t * record;
+  uint16_t stamp;
+  int i;
+
+  if (!isInit)
+    return;
+
+  if (rearm || pendingRearm || memcmp(varTocId, activeTocId, sizeof(varTocId)))
+  {
+    rearm = 0;
+    pendingRearm = false;
+    blackboxConfigure();
+  }
+
+  if (state == blackboxIdle || state == blackboxFrozen)
+  {
+    triggerParam = 0;
+    pendingCause = blackboxCauseNone;
+    return;
+  }
+
+  if (state == blackboxRecording)
+    cause = blackboxCheckTriggers(acc);
+
+  record = &ring[head * header.recordSize];
+  stamp = (uint16_t)tick;
+  memcpy(record, &stamp, sizeof(stamp));
+  record += sizeof(stamp);
+  for (i = 0; i < header.nbrVars; i++)
+  {
+    memcpy(record, varAddress[i], varLength[i]);
+    record += varLength[i];
+  }
+
+  if (cause != blackboxCauseNone)
+  {
+    header.cause = cause;
+    header.triggerTick = tick;
+    triggerHead = head;
+    postRemaining = ((uint32_t)capacity * postPercent) / 100;
+    if (postRemaining >= capacity)
+      postRemaining = capacity - 1;
+    state = blackboxTriggered;
+  }
+
+  if (++head >= capacity)
+    head = 0;
+  if (count < capacity)
+    count++;
+
+  if (state == blackboxTriggered)
+  {
+    if (postRemaining == 0)
+      blackboxFreeze();
+    else
+      postRemaining--;
+  }
+}
+
+void blackboxTrigger(blackboxCause_t cause)
+{
+  pendingCause = cause;
+}
+
+uint32_t blackboxMemGetSize(void)
+{
+  return sizeof(header) + BLACKBOX_SIZE;
+}
+
+bool blackboxMemRead(uint32_t memAddr, uint8_t readLen, uint8_t *buffer)
+{
+  uint32_t size = sizeof(header) + (uint32_t)header.count * header.recordSize;
+  uint32_t offset;
+  uint32_t index;
+  uint32_t n;
+
+  // Only a frozen recording is stable enough to be read. A read never spans
+  // more than one mem read reply (cmd, address and status take 6 bytes).
+  if (state != blackboxFrozen || readLen > CRTP_MAX_DATA_SIZE - 6 ||
+      memAddr > size || readLen > size - memAddr)
+    return false;
+
+  while (readLen > 0)
+  {
+    if (memAddr < sizeof(header))
+    {
+      n = sizeof(header) - memAddr;
+      if (n > readLen)
+        n = readLen;
+      memcpy(buffer, (uint8_t *)&header + memAddr, n);
+    }
+    else
+    {
+      offset = memAddr - sizeof(header);
+      index = (oldest + offset / header.recordSize) % capacity;
+      offset %= header.recordSize;
+      n = header.recordSize - offset;
+      if (n > readLen)
+        n = readLen;
+      memcpy(buffer, &ring[index * header.recordSize + offset], n);
+    }
+
+    buffer += n;
+    memAddr += n;
+    readLen -= n;
+  }
+
+  return true;
+}
+
+bool blackboxMemWrite(uint32_t memAddr, uint8_t writeLen, const uint8_t *buffer)
+{
+  if (memAddr != 0 || writeLen < 1)
+    return false;
+
+  if (buffer[0] == 0)
+    pendingRearm = true;
+  else
+    blackboxTrigger(blackboxCauseMem);
+
+  return true;
+}
+
+PARAM_GROUP_START(blackbox)
+PARAM_ADD(PARAM_UINT16, v0, &varTocId[0])
+PARAM_ADD(PARAM_UINT16, v1, &varTocId[1])
+PARAM_ADD(PARAM_UINT16, v2, &varTocId[2])
+PARAM_ADD(PARAM_UINT16, v3, &varTocId[3])
+PARAM_ADD(PARAM_UINT16, v4, &varTocId[4])
+PARAM_ADD(PARAM_UINT16, v5, &varTocId[5])
+PARAM_ADD(PARAM_UINT16, v6, &varTocId[6])
+PARAM_ADD(PARAM_UINT16, v7, &varTocId[7])
+PARAM_ADD(PARAM_FLOAT, crashAcc, &crashAcc)
+PARAM_ADD(PARAM_UINT8, post, &postPercent)
+PARAM_ADD(PARAM_UINT8, trigger, &triggerParam)
+PARAM_ADD(PARAM_UINT8, rearm, &rearm)
+PARAM_GROUP_STOP(blackbox)
+
+LOG_GROUP_START(blackbox)
+LOG_ADD(LOG_UINT8, state, &state)
+LOG_ADD(LOG_UINT8, cause, &header.cause)
+LOG_ADD(LOG_UINT16, count, &count)
+LOG_GROUP_STOP(blackbox)
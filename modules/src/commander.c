@@ -30,6 +30,7 @@
 #include "crtp.h"
 #include "configblock.h"
 #include "param.h"
+#include "setpointinterp.h"
 
 #define MIN_THRUST  1000
 #define MAX_THRUST  60000
@@ -50,6 +51,7 @@ static bool isInactive;
 static bool thrustLocked;
 static bool altHoldMode = false;
 static bool altHoldModeOld = false;
+static setpointInterp_t setpointInterp;
 
 static RPYType stabilizationModeRoll  = ANGLE; // Current stabilization type of roll (rate or angle)
 static RPYType stabilizationModePitch = ANGLE; // Current stabilization type of pitch (rate or angle)
@@ -72,6 +74,7 @@ void commanderInit(void)
   crtpRegisterPortCB(CRTP_PORT_COMMANDER, commanderCrtpCB);
 
   lastUpdate = xTaskGetTickCount();
+  setpointInterpInit(&setpointInterp, lastUpdate);
   isInactive = true;
   thrustLocked = true;
   isInit = true;
@@ -87,6 +90,7 @@ static void commanderCrtpCB(CRTPPacket* pk)
 {
   targetVal[!side] = *((struct CommanderCrtpValues*)pk->data);
   side = !side;
+  setpointInterpNewSample(&setpointInterp, xTaskGetTickCount());
 
   if (targetVal[side].thrust == 0) {
     thrustLocked = false;
@@ -107,10 +111,15 @@ void commanderWatchdog(void)
     targetVal[usedSide].roll = 0;
     targetVal[usedSide].pitch = 0;
     targetVal[usedSide].yaw = 0;
+    // Also clear the previous setpoint so nothing is interpolated towards it
+    targetVal[!usedSide].roll = 0;
+    targetVal[!usedSide].pitch = 0;
+    targetVal[!usedSide].yaw = 0;
   }
   if (ticktimeSinceUpdate > COMMANDER_WDT_TIMEOUT_SHUTDOWN)
   {
     targetVal[usedSide].thrust = 0;
+    targetVal[!usedSide].thrust = 0;
     altHoldMode = false; // do we need this? It would reset the target altitude upon reconnect if still hovering
     isInactive = true;
     thrustLocked = true;
@@ -134,10 +143,11 @@ uint32_t commanderGetInactivityTime(void)
 void commanderGetRPY(float* eulerRollDesired, float* eulerPitchDesired, float* eulerYawDesired)
 {
   int usedSide = side;
+  float factor = setpointInterpGetFactor(&setpointInterp, xTaskGetTickCount());
 
-  *eulerRollDesired  = targetVal[usedSide].roll;
-  *eulerPitchDesired = targetVal[usedSide].pitch;
-  *eulerYawDesired   = targetVal[usedSide].yaw;
+  *eulerRollDesired  = setpointInterpApply(targetVal[!usedSide].roll, targetVal[usedSide].roll, factor);
+  *eulerPitchDesired = setpointInterpApply(targetVal[!usedSide].pitch, targetVal[usedSide].pitch, factor);
+  *eulerYawDesired   = setpointInterpApply(targetVal[!usedSide].yaw, targetVal[usedSide].yaw, factor);
 }
 
 void commanderGetAltHold(bool* altHold, bool* setAltHold, float* altHoldChange)
@@ -183,6 +193,23 @@ void commanderGetThrust(uint16_t* thrust)
   int usedSide = side;
   uint16_t rawThrust = targetVal[usedSide].thrust;
 
+  // Thrust cut-off is applied immediately, otherwise follow the interpolated thrust
+  if (rawThrust != 0)
+  {
+    float factor = setpointInterpGetFactor(&setpointInterp, xTaskGetTickCount());
+    float interpThrust = setpointInterpApply(targetVal[!usedSide].thrust, rawThrust, factor);
+
+    if (interpThrust > UINT16_MAX)
+    {
+      interpThrust = UINT16_MAX;
+    }
+    else if (interpThrust < 0)
+    {
+      interpThrust = 0;
+    }
+    rawThrust = (uint16_t)interpThrust;
+  }
+
   if (thrustLocked)
   {
     *thrust = 0;
@@ -26,11 +26,17 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include <string.h>
+#include <math.h>
 
 #include "commanderadvanced.h"
 #include "configblock.h"
 #include "param.h"
+#include "log.h"
+#include "setpointinterp.h"
 #include "config.h"
+#include "trilateration.h"
+#include "seqlock.h"
+#include "latency.h"
 #include <inttypes.h>
 
 #include "radiolink.h"
@@ -41,6 +47,10 @@
 #define MIN_THRUST  1000
 #define MAX_THRUST  60000
 
+#define ANCHOR_COUNT        3
+#define ANCHOR_TIMEOUT      M2T(1000)
+#define POSITION_TIMEOUT    M2T(500)
+
 struct CommanderAdvancedCrtpValues {
 	uint8_t id;
 	uint16_t pid;
@@ -63,7 +73,8 @@ struct trilaterationValues {
 	uint16_t z;
 }__attribute__((packed));
 
-struct trilaterationValues dronePosition[3];
+struct trilaterationValues dronePosition[ANCHOR_COUNT];
+static uint32_t anchorTimestamp[ANCHOR_COUNT];
 /*
  struct CommanderAdvancedCrtpValues
  {
@@ -74,15 +85,78 @@ struct trilaterationValues dronePosition[3];
  } __attribute__((packed));
  */
 
-static struct CommanderAdvancedCrtpValues targetVal[2];
+/*
+ * Setpoints are handed from the CRTP RX task (producer) to the stabilizer
+ * task (consumer) through a single slot mailbox. The producer publishes each
+ * setpoint with an arrival tick and a sequence number through a seqlock, the
+ * consumer picks up the newest one when it asks for a setpoint. A sequence
+ * gap means setpoints were overwritten before being used, a seqlock retry
+ * means a copy would have been torn.
+ */
+typedef struct
+{
+	struct CommanderAdvancedCrtpValues values;
+	uint32_t timestamp; // Arrival tick
+	uint32_t sequence;  // Arrival count, 0 before the first setpoint
+	latencyTrace_t trace;
+} SetpointSample;
+
+typedef enum
+{
+	SETPOINT_SOURCE_GROUND = 0,
+	SETPOINT_SOURCE_NEIGHBOUR,
+	SETPOINT_SOURCE_COUNT,
+} SetpointSource;
+
+typedef struct
+{
+	uint32_t count;       // Setpoints received
+	uint32_t interval;    // Ticks since the previous setpoint from this source
+	uint32_t maxInterval;
+	uint32_t lastTime;
+} SetpointSourceStats;
+
+static seqlock_t setpointLock;
+static SetpointSample setpointMailbox[2];
+static SetpointSourceStats sourceStats[SETPOINT_SOURCE_COUNT];
+
+// Producer side, only used from the CRTP RX task
+static uint32_t setpointSequence;
+static struct CommanderAdvancedCrtpValues rxVal[2]; // Received packets, answered with our id
+static int rxSide = 0;
 static struct CommanderAdvancedCrtpValues lastReceived;
-static bool isInit;
+static uint32_t txDropped;   // Answers dropped on a full TX queue
+
+// Consumer side, only used from the stabilizer task
+static struct CommanderAdvancedCrtpValues targetVal[2];
 static int side = 0;
+static uint32_t targetTime;       // Arrival tick of targetVal[side]
+static uint32_t consumedSequence;
+static uint32_t overwritten;      // Setpoints replaced before being used
+static uint32_t tornReads;        // Mailbox reads retried
+static uint32_t staleCount;       // Times the setpoint timed out
+
+static bool isInit;
 static uint32_t lastUpdate;
 static bool isInactive;
 static bool thrustLocked;
 static bool altHoldMode = false;
 static bool altHoldModeOld = false;
+static setpointInterp_t setpointInterp;
+
+static positionEstimate_t positionEstimate;
+static seqlock_t positionLock;             // Publishes positionEstimate to the stabilizer
+static positionEstimate_t positionCopy[2];
+static bool positionValid;
+
+typedef struct {
+	trajectoryPoint_t point;
+	bool valid;
+} positionSetpoint_t;
+static seqlock_t positionSetpointLock;     // Publishes the setpoint to the stabilizer
+static positionSetpoint_t positionSetpointCopy[2];
+static float rssiAt1m = 45.0f;        // RSSI (-dBm) measured at 1m distance
+static float pathLossExponent = 2.0f; // 2.0 in free space
 
 static RPYType stabilizationModeRoll = ANGLE; // Current stabilization type of roll (rate or angle)
 static RPYType stabilizationModePitch = ANGLE; // Current stabilization type of pitch (rate or angle)
@@ -103,6 +177,11 @@ void commanderAdvancedInit(void) {
 	crtpRegisterPortCB(CRTP_PORT_COMMANDER, commanderAdvancedCrtpCB);
 
 	lastUpdate = xTaskGetTickCount();
+	targetTime = lastUpdate;
+	setpointInterpInit(&setpointInterp, lastUpdate);
+	seqlockInit(&setpointLock);
+	seqlockInit(&positionLock);
+	seqlockInit(&positionSetpointLock);
 	isInactive = true;
 	thrustLocked = true;
 	isInit = true;
@@ -113,37 +192,231 @@ bool commanderAdvancedTest(void) {
 	return isInit;
 }
 
-static void commanderAdvancedCrtpCB(CRTPPacket* pk) {
-	targetVal[!side] = *((struct CommanderAdvancedCrtpValues*) pk->data);
-	side = !side;
-	lastReceived = targetVal[side];
-	if(targetVal[side].id != 0){
-		DEBUG_PRINT("\n %d receive a trame from ID %d \n", CRAZYFLIE_ID, targetVal[side].id);
+static void commanderAdvancedUpdateSourceStats(SetpointSource source, uint32_t now) {
+	SetpointSourceStats* stats = &sourceStats[source];
+
+	if (stats->count > 0) {
+		stats->interval = now - stats->lastTime;
+		if (stats->interval > stats->maxInterval) {
+			stats->maxInterval = stats->interval;
+		}
+	}
+	stats->lastTime = now;
+	stats->count++;
+}
+
+static void commanderAdvancedPublishSetpoint(const struct CommanderAdvancedCrtpValues* values,
+		uint32_t now, const latencyTrace_t* trace) {
+	setpointSequence++;
+
+	seqlockWriteBegin(&setpointLock);
+	setpointMailbox[0].values = *values;
+	setpointMailbox[0].timestamp = now;
+	setpointMailbox[0].trace = *trace;
+	setpointMailbox[0].sequence = setpointSequence;
+	seqlockWriteSwitch(&setpointLock);
+	setpointMailbox[1] = setpointMailbox[0];
+}
+
+/**
+ * Takes the newest setpoint from the mailbox, if there is one. Only called
+ * from the stabilizer task.
+ */
+static void commanderAdvancedFetchSetpoint(void) {
+	SetpointSample sample;
+	uint32_t sequence;
+
+	// Nothing published since the last fetch, the common case
+	sequence = seqlockReadBegin(&setpointLock);
+	if (setpointMailbox[seqlockReadIndex(sequence)].sequence == consumedSequence) {
+		return;
 	}
-	targetVal[side].id = CRAZYFLIE_ID;
 
-	if (targetVal[side].thrust == 0) {
+	while (true) {
+		sample = setpointMailbox[seqlockReadIndex(sequence)];
+		if (!seqlockReadRetry(&setpointLock, sequence)) {
+			break;
+		}
+		tornReads++;
+		sequence = seqlockReadBegin(&setpointLock);
+	}
+
+	overwritten += sample.sequence - consumedSequence - 1;
+	consumedSequence = sample.sequence;
+
+	targetVal[!side] = sample.values;
+	side = !side;
+	targetTime = sample.timestamp;
+	setpointInterpNewSample(&setpointInterp, sample.timestamp);
+	latencyFetched(&sample.trace);
+}
+
+static void commanderAdvancedCrtpCB(CRTPPacket* pk) {
+	uint32_t now = xTaskGetTickCount();
+	latencyTrace_t trace;
+
+	rxVal[!rxSide] = *((struct CommanderAdvancedCrtpValues*) pk->data);
+	rxSide = !rxSide;
+	lastReceived = rxVal[rxSide];
+	commanderAdvancedUpdateSourceStats(
+			(lastReceived.id == 0) ? SETPOINT_SOURCE_GROUND : SETPOINT_SOURCE_NEIGHBOUR, now);
+	rxVal[rxSide].id = CRAZYFLIE_ID;
+
+	if (rxVal[rxSide].thrust == 0) {
 		thrustLocked = false;
 	}
 
+	// A latency tag from the ground station follows the setpoint
+	latencyCapture(&trace, pk, sizeof(struct CommanderAdvancedCrtpValues));
+	commanderAdvancedPublishSetpoint(&rxVal[rxSide], now, &trace);
+
 	//TODO
 	//Appliquer des calculs (triangularisation) pour redefinir x, y, z
 	processCommanderAdvanced();
 
 	createCommanderAdvancedPacket(pk);
 
-	crtpSendPacket(pk);
+	// Never blocks, the answer is dropped if the TX queue is full
+	if (!crtpSendPacket(pk)) {
+		txDropped++;
+	}
 	commanderAdvancedWatchdogReset();
 }
 
-//TODO
+/**
+ * Converts an RSSI reading (-dBm) to a distance in meters using the
+ * log-distance path loss model.
+ */
+static double rssiToDistance(uint8_t rssi) {
+	return pow(10.0, (rssi - rssiAt1m) / (10.0f * pathLossExponent));
+}
+
+static coordinate anchorToCoordinate(const struct trilaterationValues* anchor) {
+	coordinate c;
+
+	c.x = anchor->x / 1000.0;
+	c.y = anchor->y / 1000.0;
+	c.z = anchor->z / 1000.0;
+	return c;
+}
+
+/**
+ * Handles the last received packet. A packet from the ground (id 0) carries
+ * the position setpoint, a packet relayed from a neighbour carries its
+ * position and the RSSI it was received with. Once three recent neighbours
+ * are known our own position is trilaterated from them.
+ */
 void processCommanderAdvanced(void) {
+	uint32_t now = xTaskGetTickCount();
+	int slot = 0;
+	int i;
+	coordinate result1, result2, oldPosition;
+	positionSetpoint_t setpoint;
+
+	if (lastReceived.id == 0) {
+		setpoint.point.x = lastReceived.x / 1000.0f;
+		setpoint.point.y = lastReceived.y / 1000.0f;
+		setpoint.point.z = lastReceived.z / 1000.0f;
+		setpoint.point.vx = 0;
+		setpoint.point.vy = 0;
+		setpoint.point.vz = 0;
+		setpoint.point.yaw = lastReceived.yaw;
+		setpoint.valid = (lastReceived.z > 0);
+
+		// The stabilizer reads it at any time, it must never see half of it
+		seqlockWriteBegin(&positionSetpointLock);
+		positionSetpointCopy[0] = setpoint;
+		seqlockWriteSwitch(&positionSetpointLock);
+		positionSetpointCopy[1] = setpoint;
+		return;
+	}
 
+	// Update the slot of this neighbour, or replace the oldest one
+	for (i = 0; i < ANCHOR_COUNT; i++) {
+		if (dronePosition[i].id == lastReceived.id) {
+			slot = i;
+			break;
+		}
+		if (anchorTimestamp[i] < anchorTimestamp[slot]) {
+			slot = i;
+		}
+	}
+	dronePosition[slot].id = lastReceived.id;
+	dronePosition[slot].pid = lastReceived.pid;
+	dronePosition[slot].rssi = lastReceived.rssi;
+	dronePosition[slot].x = lastReceived.x;
+	dronePosition[slot].y = lastReceived.y;
+	dronePosition[slot].z = lastReceived.z;
+	anchorTimestamp[slot] = now;
+
+	for (i = 0; i < ANCHOR_COUNT; i++) {
+		if (dronePosition[i].id == 0 || now - anchorTimestamp[i] > ANCHOR_TIMEOUT) {
+			return;
+		}
+	}
+
+	if (trilateration(&result1, &result2,
+			anchorToCoordinate(&dronePosition[0]), rssiToDistance(dronePosition[0].rssi),
+			anchorToCoordinate(&dronePosition[1]), rssiToDistance(dronePosition[1].rssi),
+			anchorToCoordinate(&dronePosition[2]), rssiToDistance(dronePosition[2].rssi),
+			MAXZERO) == 0) {
+		oldPosition.x = positionEstimate.x;
+		oldPosition.y = positionEstimate.y;
+		oldPosition.z = positionEstimate.z;
+		result1 = getResult(result1, result2, oldPosition);
+
+		positionEstimate.x = result1.x;
+		positionEstimate.y = result1.y;
+		positionEstimate.z = result1.z;
+		positionEstimate.timestamp = now;
+
+		seqlockWriteBegin(&positionLock);
+		positionCopy[0] = positionEstimate;
+		seqlockWriteSwitch(&positionLock);
+		positionCopy[1] = positionEstimate;
+		positionValid = true;
+	}
+}
+
+bool commanderAdvancedGetPositionEstimate(positionEstimate_t* estimate) {
+	uint32_t sequence;
+
+	if (!positionValid) {
+		return false;
+	}
+
+	do {
+		sequence = seqlockReadBegin(&positionLock);
+		*estimate = positionCopy[seqlockReadIndex(sequence)];
+	} while (seqlockReadRetry(&positionLock, sequence));
+
+	return xTaskGetTickCount() - estimate->timestamp <= POSITION_TIMEOUT;
+}
+
+bool commanderAdvancedGetPositionSetpoint(trajectoryPoint_t* setpoint) {
+	positionSetpoint_t copy;
+	uint32_t sequence;
+
+	if (isInactive) {
+		return false;
+	}
+
+	do {
+		sequence = seqlockReadBegin(&positionSetpointLock);
+		copy = positionSetpointCopy[seqlockReadIndex(sequence)];
+	} while (seqlockReadRetry(&positionSetpointLock, sequence));
+
+	if (!copy.valid) {
+		return false;
+	}
+
+	*setpoint = copy.point;
+	return true;
 }
 
 void createCommanderAdvancedPacket(CRTPPacket* p){
 	// targetValues represent the new data received in this instant
-	struct CommanderAdvancedCrtpValues targetValues = targetVal[side];
+	struct CommanderAdvancedCrtpValues targetValues = rxVal[rxSide];
 
 	p -> data[0] = targetValues.id;
 	p -> data[3] = targetValues.rssi;
@@ -162,8 +435,8 @@ void createCommanderAdvancedPacket(CRTPPacket* p){
 void updateCommanderAdvancedPacket(CRTPPacket* p){
 	/* targetValues represent the new data received in this instant
 	 */
-	struct CommanderAdvancedCrtpValues targetValues = targetVal[side];
-	struct CommanderAdvancedCrtpValues currentValues = targetVal[!side];
+	struct CommanderAdvancedCrtpValues targetValues = rxVal[rxSide];
+	struct CommanderAdvancedCrtpValues currentValues = rxVal[!rxSide];
 
 	uint16_t targetX = targetValues.x - currentValues.x;
 	uint16_t targetY = targetValues.y - currentValues.y;
@@ -182,18 +455,29 @@ void updateCommanderAdvancedPacket(CRTPPacket* p){
 }
 
 void commanderAdvancedWatchdog(void) {
-	int usedSide = side;
+	int usedSide;
 	uint32_t ticktimeSinceUpdate;
 
-	ticktimeSinceUpdate = xTaskGetTickCount() - lastUpdate;
+	commanderAdvancedFetchSetpoint();
+	usedSide = side;
+	ticktimeSinceUpdate = xTaskGetTickCount() - targetTime;
 
 	if (ticktimeSinceUpdate > COMMANDER_WDT_TIMEOUT_STABALIZE) {
+		if (targetVal[usedSide].roll != 0 || targetVal[usedSide].pitch != 0
+				|| targetVal[usedSide].yaw != 0) {
+			staleCount++;
+		}
 		targetVal[usedSide].roll = 0;
 		targetVal[usedSide].pitch = 0;
 		targetVal[usedSide].yaw = 0;
+		// Also clear the previous setpoint so nothing is interpolated towards it
+		targetVal[!usedSide].roll = 0;
+		targetVal[!usedSide].pitch = 0;
+		targetVal[!usedSide].yaw = 0;
 	}
 	if (ticktimeSinceUpdate > COMMANDER_WDT_TIMEOUT_SHUTDOWN) {
 		targetVal[usedSide].thrust = 0;
+		targetVal[!usedSide].thrust = 0;
 		altHoldMode = false; // do we need this? It would reset the target altitude upon reconnect if still hovering
 		isInactive = true;
 		thrustLocked = true;
@@ -212,15 +496,24 @@ uint32_t commanderAdvancedGetInactivityTime(void) {
 
 void commanderAdvancedGetRPY(float* eulerRollDesired, float* eulerPitchDesired,
 		float* eulerYawDesired) {
-	int usedSide = side;
-
-	*eulerRollDesired = targetVal[usedSide].roll;
-	*eulerPitchDesired = targetVal[usedSide].pitch;
-	*eulerYawDesired = targetVal[usedSide].yaw;
+	int usedSide;
+	float factor;
+
+	commanderAdvancedFetchSetpoint();
+	usedSide = side;
+	factor = setpointInterpGetFactor(&setpointInterp, xTaskGetTickCount());
+
+	*eulerRollDesired = setpointInterpApply(targetVal[!usedSide].roll,
+			targetVal[usedSide].roll, factor);
+	*eulerPitchDesired = setpointInterpApply(targetVal[!usedSide].pitch,
+			targetVal[usedSide].pitch, factor);
+	*eulerYawDesired = setpointInterpApply(targetVal[!usedSide].yaw,
+			targetVal[usedSide].yaw, factor);
 }
 
 void commanderAdvancedGetAltHold(bool* altHold, bool* setAltHold,
 		float* altHoldChange) {
+	commanderAdvancedFetchSetpoint();
 	*altHold = altHoldMode; // Still in altitude hold mode
 	*setAltHold = !altHoldModeOld && altHoldMode; // Hover just activated
 	*altHoldChange =
@@ -258,8 +551,27 @@ void commanderAdvancedGetRPYType(RPYType* rollType, RPYType* pitchType,
 }
 
 void commanderAdvancedGetThrust(uint16_t* thrust) {
-	int usedSide = side;
-	uint16_t rawThrust = targetVal[usedSide].thrust;
+	int usedSide;
+	uint16_t rawThrust;
+
+	commanderAdvancedFetchSetpoint();
+	usedSide = side;
+	rawThrust = targetVal[usedSide].thrust;
+
+	// Thrust cut-off is applied immediately, otherwise follow the interpolated thrust
+	if (rawThrust != 0) {
+		float factor = setpointInterpGetFactor(&setpointInterp,
+				xTaskGetTickCount());
+		float interpThrust = setpointInterpApply(targetVal[!usedSide].thrust,
+				rawThrust, factor);
+
+		if (interpThrust > UINT16_MAX) {
+			interpThrust = UINT16_MAX;
+		} else if (interpThrust < 0) {
+			interpThrust = 0;
+		}
+		rawThrust = (uint16_t) interpThrust;
+	}
 
 	if (thrustLocked) {
 		*thrust = 0;
@@ -294,3 +606,22 @@ PARAM_GROUP_START(flightmode) PARAM_ADD(PARAM_UINT8, althold, &altHoldMode)
 		PARAM_ADD(PARAM_UINT8, stabModePitch, &stabilizationModePitch)
 		PARAM_ADD(PARAM_UINT8, stabModeYaw, &stabilizationModeYaw)
 		PARAM_GROUP_STOP(flightmode)
+
+LOG_GROUP_START(setpoint)
+LOG_ADD(LOG_UINT32, gndCount, &sourceStats[SETPOINT_SOURCE_GROUND].count)
+LOG_ADD(LOG_UINT32, gndGap, &sourceStats[SETPOINT_SOURCE_GROUND].interval)
+LOG_ADD(LOG_UINT32, gndMaxGap, &sourceStats[SETPOINT_SOURCE_GROUND].maxInterval)
+LOG_ADD(LOG_UINT32, nbrCount, &sourceStats[SETPOINT_SOURCE_NEIGHBOUR].count)
+LOG_ADD(LOG_UINT32, nbrGap, &sourceStats[SETPOINT_SOURCE_NEIGHBOUR].interval)
+LOG_ADD(LOG_UINT32, nbrMaxGap, &sourceStats[SETPOINT_SOURCE_NEIGHBOUR].maxInterval)
+LOG_ADD(LOG_UINT32, overwritten, &overwritten)
+LOG_ADD(LOG_UINT32, torn, &tornReads)
+LOG_ADD(LOG_UINT32, stale, &staleCount)
+LOG_ADD(LOG_UINT32, txDrop, &txDropped)
+LOG_GROUP_STOP(setpoint)
+
+// Params for RSSI ranging
+PARAM_GROUP_START(trilat)
+PARAM_ADD(PARAM_FLOAT, rssi1m, &rssiAt1m)
+PARAM_ADD(PARAM_FLOAT, pathLoss, &pathLossExponent)
+PARAM_GROUP_STOP(trilat)
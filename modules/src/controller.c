@@ -24,6 +24,7 @@
  *
  */
 #include <stdbool.h>
+#include <string.h>
  
 #include "FreeRTOS.h"
 
@@ -31,6 +32,9 @@
 #include "pid.h"
 #include "param.h"
 #include "imu.h"
+#include "log.h"
+#include "fixmath.h"
+#include "cyclecounter.h"
 
 static inline int16_t saturateSignedInt16(float in)
 {
@@ -43,62 +47,298 @@ static inline int16_t saturateSignedInt16(float in)
     return (int16_t)in;
 }
 
-PidObject pidRollRate;
-PidObject pidPitchRate;
-PidObject pidYawRate;
-PidObject pidRoll;
-PidObject pidPitch;
-PidObject pidYaw;
+#ifdef CONTROL_FIXED_POINT
+/* No FPU, the PIDs run in fixed point and only the interface is float. */
+typedef PidFixObject ControllerPid;
+#define controllerPidInit             pidFixInit
+#define controllerPidSetIntegralLimit pidFixSetIntegralLimit
+#define controllerPidReset            pidFixReset
+#define controllerPidSetKp            pidFixSetKp
+#define controllerPidSetKi            pidFixSetKi
+#define controllerPidSetKd            pidFixSetKd
+
+static inline int16_t saturateFixToInt16(int32_t in)
+{
+  return (int16_t)((in >> FIX_Q16) > INT16_MAX ? INT16_MAX :
+                   (in >> FIX_Q16) < -INT16_MAX ? -INT16_MAX : (in >> FIX_Q16));
+}
+#else
+typedef PidObject ControllerPid;
+#define controllerPidInit             pidInit
+#define controllerPidSetIntegralLimit pidSetIntegralLimit
+#define controllerPidReset            pidReset
+#define controllerPidSetKp            pidSetKp
+#define controllerPidSetKi            pidSetKi
+#define controllerPidSetKd            pidSetKd
+#endif
+
+ControllerPid pidRollRate;
+ControllerPid pidPitchRate;
+ControllerPid pidYawRate;
+ControllerPid pidRoll;
+ControllerPid pidPitch;
+ControllerPid pidYaw;
 
 int16_t rollOutput;
 int16_t pitchOutput;
 int16_t yawOutput;
 
+/* Base PID gains, scaled by the gain schedule before being applied to the PIDs. */
+typedef struct
+{
+  float kp;
+  float ki;
+  float kd;
+} PidGains;
+
+static PidGains gainsRollRate  = { PID_ROLL_RATE_KP,  PID_ROLL_RATE_KI,  PID_ROLL_RATE_KD };
+static PidGains gainsPitchRate = { PID_PITCH_RATE_KP, PID_PITCH_RATE_KI, PID_PITCH_RATE_KD };
+static PidGains gainsYawRate   = { PID_YAW_RATE_KP,   PID_YAW_RATE_KI,   PID_YAW_RATE_KD };
+static PidGains gainsRoll      = { PID_ROLL_KP,       PID_ROLL_KI,       PID_ROLL_KD };
+static PidGains gainsPitch     = { PID_PITCH_KP,      PID_PITCH_KI,      PID_PITCH_KD };
+static PidGains gainsYaw       = { PID_YAW_KP,        PID_YAW_KI,        PID_YAW_KD };
+
+/* Base gains and scale last applied to a PID. Applying converts the gains,
+ * which is soft float work on the CF1, so it is only done when they change. */
+typedef struct
+{
+  PidGains gains;
+  float scale;
+} ScheduledGains;
+
+static ScheduledGains appliedRollRate;
+static ScheduledGains appliedPitchRate;
+static ScheduledGains appliedYawRate;
+static ScheduledGains appliedRoll;
+static ScheduledGains appliedPitch;
+static ScheduledGains appliedYaw;
+
+/* Gain schedule indexed by thrust. Scales are linearly interpolated between
+ * the thrust points and held constant outside them. */
+#define GAIN_SCHEDULE_SIZE 3
+static uint16_t gainSchedThrust[GAIN_SCHEDULE_SIZE]   = { 20000, 40000, 60000 };
+static float gainSchedRate[GAIN_SCHEDULE_SIZE]        = { 1.0, 1.0, 1.0 };
+static float gainSchedAttitude[GAIN_SCHEDULE_SIZE]    = { 1.0, 1.0, 1.0 };
+static float rateScale = 1.0;
+static float attitudeScale = 1.0;
+
+/* Symbols set by the linker script */
+extern const Controller * _controller_start;
+extern const Controller * _controller_stop;
+
+static const Controller ** controllers;
+static int controllersLen;
+static const Controller * active;
+
+static uint8_t controllerType = CONTROLLER_PID;   // Requested controller
+static uint8_t controllerActiveType;
+
+/* Execution time of each controller, indexed by id. Cycles of one rate update
+ * plus the attitude update preceding it, if any. */
+#define CONTROLLER_STATS_SIZE 4
+static uint32_t execCycles[CONTROLLER_STATS_SIZE];     // Filtered
+static uint32_t execCyclesMax[CONTROLLER_STATS_SIZE];
+static uint32_t attitudeCycles;
+
 static bool isInit;
 
+static void pidControllerInit(void)
+{
+  //TODO: get parameters from configuration manager instead
+  controllerPidInit(&pidRollRate, 0, gainsRollRate.kp, gainsRollRate.ki, gainsRollRate.kd, IMU_UPDATE_DT);
+  controllerPidInit(&pidPitchRate, 0, gainsPitchRate.kp, gainsPitchRate.ki, gainsPitchRate.kd, IMU_UPDATE_DT);
+  controllerPidInit(&pidYawRate, 0, gainsYawRate.kp, gainsYawRate.ki, gainsYawRate.kd, IMU_UPDATE_DT);
+  controllerPidSetIntegralLimit(&pidRollRate, PID_ROLL_RATE_INTEGRATION_LIMIT);
+  controllerPidSetIntegralLimit(&pidPitchRate, PID_PITCH_RATE_INTEGRATION_LIMIT);
+  controllerPidSetIntegralLimit(&pidYawRate, PID_YAW_RATE_INTEGRATION_LIMIT);
+
+  controllerPidInit(&pidRoll, 0, gainsRoll.kp, gainsRoll.ki, gainsRoll.kd, IMU_UPDATE_DT);
+  controllerPidInit(&pidPitch, 0, gainsPitch.kp, gainsPitch.ki, gainsPitch.kd, IMU_UPDATE_DT);
+  controllerPidInit(&pidYaw, 0, gainsYaw.kp, gainsYaw.ki, gainsYaw.kd, IMU_UPDATE_DT);
+  controllerPidSetIntegralLimit(&pidRoll, PID_ROLL_INTEGRATION_LIMIT);
+  controllerPidSetIntegralLimit(&pidPitch, PID_PITCH_INTEGRATION_LIMIT);
+  controllerPidSetIntegralLimit(&pidYaw, PID_YAW_INTEGRATION_LIMIT);
+}
+
+static const Controller* controllerFind(uint8_t id)
+{
+  int i;
+
+  for (i = 0; i < controllersLen; i++)
+  {
+    if (controllers[i]->id == id)
+    {
+      return controllers[i];
+    }
+  }
+  return NULL;
+}
+
 void controllerInit()
 {
+  int i;
+
   if(isInit)
     return;
-  
-  //TODO: get parameters from configuration manager instead
-  pidInit(&pidRollRate, 0, PID_ROLL_RATE_KP, PID_ROLL_RATE_KI, PID_ROLL_RATE_KD, IMU_UPDATE_DT);
-  pidInit(&pidPitchRate, 0, PID_PITCH_RATE_KP, PID_PITCH_RATE_KI, PID_PITCH_RATE_KD, IMU_UPDATE_DT);
-  pidInit(&pidYawRate, 0, PID_YAW_RATE_KP, PID_YAW_RATE_KI, PID_YAW_RATE_KD, IMU_UPDATE_DT);
-  pidSetIntegralLimit(&pidRollRate, PID_ROLL_RATE_INTEGRATION_LIMIT);
-  pidSetIntegralLimit(&pidPitchRate, PID_PITCH_RATE_INTEGRATION_LIMIT);
-  pidSetIntegralLimit(&pidYawRate, PID_YAW_RATE_INTEGRATION_LIMIT);
-
-  pidInit(&pidRoll, 0, PID_ROLL_KP, PID_ROLL_KI, PID_ROLL_KD, IMU_UPDATE_DT);
-  pidInit(&pidPitch, 0, PID_PITCH_KP, PID_PITCH_KI, PID_PITCH_KD, IMU_UPDATE_DT);
-  pidInit(&pidYaw, 0, PID_YAW_KP, PID_YAW_KI, PID_YAW_KD, IMU_UPDATE_DT);
-  pidSetIntegralLimit(&pidRoll, PID_ROLL_INTEGRATION_LIMIT);
-  pidSetIntegralLimit(&pidPitch, PID_PITCH_INTEGRATION_LIMIT);
-  pidSetIntegralLimit(&pidYaw, PID_YAW_INTEGRATION_LIMIT);
+
+  controllers = &_controller_start;
+  controllersLen = &_controller_stop - &_controller_start;
+
+  for (i = 0; i < controllersLen; i++)
+  {
+    if (controllers[i]->init)
+    {
+      controllers[i]->init();
+    }
+  }
+
+  active = controllerFind(CONTROLLER_PID);
+  controllerActiveType = CONTROLLER_PID;
   
   isInit = true;
 }
 
 bool controllerTest()
 {
-  return isInit;
+  bool pass = isInit && (active != NULL);
+  int i;
+
+  for (i = 0; i < controllersLen; i++)
+  {
+    if (controllers[i]->test)
+    {
+      pass &= controllers[i]->test();
+    }
+  }
+
+  return pass;
 }
 
-void controllerCorrectRatePID(
+static float gainScheduleLookup(const float* scales, uint16_t thrust)
+{
+  int i;
+
+  if (thrust <= gainSchedThrust[0])
+    return scales[0];
+
+  for (i = 1; i < GAIN_SCHEDULE_SIZE; i++)
+  {
+    if (thrust < gainSchedThrust[i])
+    {
+      float frac;
+
+      if (scales[i] == scales[i-1])
+        return scales[i];
+
+      frac = (float)(thrust - gainSchedThrust[i-1]) /
+             (gainSchedThrust[i] - gainSchedThrust[i-1]);
+      return scales[i-1] + (scales[i] - scales[i-1]) * frac;
+    }
+  }
+
+  return scales[GAIN_SCHEDULE_SIZE - 1];
+}
+
+static void gainScheduleApply(ControllerPid* pid, ScheduledGains* applied,
+                              const PidGains* gains, float scale)
+{
+  ScheduledGains next = { *gains, scale };
+
+  // The base gains are params, so they are compared rather than flagged
+  if (!memcmp(&next, applied, sizeof(next)))
+    return;
+  *applied = next;
+
+  // Only the gains are changed, the integrator state is kept
+  controllerPidSetKp(pid, gains->kp * scale);
+  controllerPidSetKi(pid, gains->ki * scale);
+  controllerPidSetKd(pid, gains->kd * scale);
+}
+
+void controllerScheduleGains(uint16_t thrust)
+{
+  rateScale = gainScheduleLookup(gainSchedRate, thrust);
+  attitudeScale = gainScheduleLookup(gainSchedAttitude, thrust);
+
+  gainScheduleApply(&pidRollRate, &appliedRollRate, &gainsRollRate, rateScale);
+  gainScheduleApply(&pidPitchRate, &appliedPitchRate, &gainsPitchRate, rateScale);
+  gainScheduleApply(&pidYawRate, &appliedYawRate, &gainsYawRate, rateScale);
+  gainScheduleApply(&pidRoll, &appliedRoll, &gainsRoll, attitudeScale);
+  gainScheduleApply(&pidPitch, &appliedPitch, &gainsPitch, attitudeScale);
+  gainScheduleApply(&pidYaw, &appliedYaw, &gainsYaw, attitudeScale);
+}
+
+void controllerSetBaseGains(bool rateLoop, int axis, float kp, float ki, float kd)
+{
+  static PidGains* const rateGains[] = { &gainsRollRate, &gainsPitchRate, &gainsYawRate };
+  static PidGains* const attitudeGains[] = { &gainsRoll, &gainsPitch, &gainsYaw };
+  PidGains* gains;
+
+  if (axis < 0 || axis > 2)
+    return;
+
+  gains = rateLoop ? rateGains[axis] : attitudeGains[axis];
+  gains->kp = kp;
+  gains->ki = ki;
+  gains->kd = kd;
+}
+
+#ifdef CONTROL_FIXED_POINT
+static void pidControllerUpdateRate(
        float rollRateActual, float pitchRateActual, float yawRateActual,
-       float rollRateDesired, float pitchRateDesired, float yawRateDesired)
+       float rollRateDesired, float pitchRateDesired, float yawRateDesired,
+       int16_t* roll, int16_t* pitch, int16_t* yaw)
+{
+  pidFixSetDesired(&pidRollRate, fixFromFloat(rollRateDesired, FIX_Q16));
+  *roll = saturateFixToInt16(pidFixUpdate(&pidRollRate, fixFromFloat(rollRateActual, FIX_Q16), true));
+
+  pidFixSetDesired(&pidPitchRate, fixFromFloat(pitchRateDesired, FIX_Q16));
+  *pitch = saturateFixToInt16(pidFixUpdate(&pidPitchRate, fixFromFloat(pitchRateActual, FIX_Q16), true));
+
+  pidFixSetDesired(&pidYawRate, fixFromFloat(yawRateDesired, FIX_Q16));
+  *yaw = saturateFixToInt16(pidFixUpdate(&pidYawRate, fixFromFloat(yawRateActual, FIX_Q16), true));
+}
+
+static void pidControllerUpdateAttitude(
+       float eulerRollActual, float eulerPitchActual, float eulerYawActual,
+       float eulerRollDesired, float eulerPitchDesired, float eulerYawDesired,
+       float* rollRateDesired, float* pitchRateDesired, float* yawRateDesired)
+{
+  int32_t yawError;
+
+  pidFixSetDesired(&pidRoll, fixFromFloat(eulerRollDesired, FIX_Q16));
+  *rollRateDesired = FIX_TO_FLOAT(pidFixUpdate(&pidRoll, fixFromFloat(eulerRollActual, FIX_Q16), true), FIX_Q16);
+
+  // Update PID for pitch axis
+  pidFixSetDesired(&pidPitch, fixFromFloat(eulerPitchDesired, FIX_Q16));
+  *pitchRateDesired = FIX_TO_FLOAT(pidFixUpdate(&pidPitch, fixFromFloat(eulerPitchActual, FIX_Q16), true), FIX_Q16);
+
+  // Update PID for yaw axis
+  yawError = fixFromFloat(eulerYawDesired, FIX_Q16) - fixFromFloat(eulerYawActual, FIX_Q16);
+  if (yawError > 180 * FIX_ONE(FIX_Q16))
+    yawError -= 360 * FIX_ONE(FIX_Q16);
+  else if (yawError < -180 * FIX_ONE(FIX_Q16))
+    yawError += 360 * FIX_ONE(FIX_Q16);
+  pidFixSetError(&pidYaw, yawError);
+  *yawRateDesired = FIX_TO_FLOAT(pidFixUpdate(&pidYaw, 0, false), FIX_Q16);
+}
+#else
+static void pidControllerUpdateRate(
+       float rollRateActual, float pitchRateActual, float yawRateActual,
+       float rollRateDesired, float pitchRateDesired, float yawRateDesired,
+       int16_t* roll, int16_t* pitch, int16_t* yaw)
 {
   pidSetDesired(&pidRollRate, rollRateDesired);
-  rollOutput = saturateSignedInt16(pidUpdate(&pidRollRate, rollRateActual, true));
+  *roll = saturateSignedInt16(pidUpdate(&pidRollRate, rollRateActual, true));
 
   pidSetDesired(&pidPitchRate, pitchRateDesired);
-  pitchOutput = saturateSignedInt16(pidUpdate(&pidPitchRate, pitchRateActual, true));
+  *pitch = saturateSignedInt16(pidUpdate(&pidPitchRate, pitchRateActual, true));
 
   pidSetDesired(&pidYawRate, yawRateDesired);
-  yawOutput = saturateSignedInt16(pidUpdate(&pidYawRate, yawRateActual, true));
+  *yaw = saturateSignedInt16(pidUpdate(&pidYawRate, yawRateActual, true));
 }
 
-void controllerCorrectAttitudePID(
+static void pidControllerUpdateAttitude(
        float eulerRollActual, float eulerPitchActual, float eulerYawActual,
        float eulerRollDesired, float eulerPitchDesired, float eulerYawDesired,
        float* rollRateDesired, float* pitchRateDesired, float* yawRateDesired)
@@ -120,15 +360,121 @@ void controllerCorrectAttitudePID(
   pidSetError(&pidYaw, yawError);
   *yawRateDesired = pidUpdate(&pidYaw, eulerYawActual, false);
 }
+#endif
+
+static void pidControllerReset(int16_t roll, int16_t pitch, int16_t yaw)
+{
+  // Without a rate integrator there is no state to carry the output over in
+  controllerPidReset(&pidRollRate);
+  controllerPidReset(&pidPitchRate);
+  controllerPidReset(&pidYawRate);
+}
+
+static bool pidControllerTest(void)
+{
+  return true;
+}
+
+static const Controller pidController = {
+  .id = CONTROLLER_PID,
+  .name = "PID",
+  .init = pidControllerInit,
+  .test = pidControllerTest,
+  .reset = pidControllerReset,
+  .updateAttitude = pidControllerUpdateAttitude,
+  .updateRate = pidControllerUpdateRate,
+};
+
+CONTROLLER(pidController);
+
+void controllerSetType(ControllerType type)
+{
+  controllerType = type;
+}
+
+ControllerType controllerGetType(void)
+{
+  return controllerActiveType;
+}
+
+void controllerUpdateSelection(void)
+{
+  const Controller* next;
+
+  if (controllerType == controllerActiveType)
+    return;
+
+  next = controllerFind(controllerType);
+  if (next == NULL)
+  {
+    // Unknown id, keep flying the current controller
+    controllerType = controllerActiveType;
+    return;
+  }
+
+  // The attitude PIDs are shared by all controllers without their own
+  // attitude update, they start over as well
+  controllerPidReset(&pidRoll);
+  controllerPidReset(&pidPitch);
+  controllerPidReset(&pidYaw);
+  next->reset(rollOutput, pitchOutput, yawOutput);
+
+  active = next;
+  controllerActiveType = next->id;
+}
+
+void controllerCorrectAttitudePID(
+       float eulerRollActual, float eulerPitchActual, float eulerYawActual,
+       float eulerRollDesired, float eulerPitchDesired, float eulerYawDesired,
+       float* rollRateDesired, float* pitchRateDesired, float* yawRateDesired)
+{
+  uint32_t start = cycleCounterGet();
+
+  if (active->updateAttitude)
+  {
+    active->updateAttitude(eulerRollActual, eulerPitchActual, eulerYawActual,
+                           eulerRollDesired, eulerPitchDesired, eulerYawDesired,
+                           rollRateDesired, pitchRateDesired, yawRateDesired);
+  }
+  else
+  {
+    pidControllerUpdateAttitude(eulerRollActual, eulerPitchActual, eulerYawActual,
+                                eulerRollDesired, eulerPitchDesired, eulerYawDesired,
+                                rollRateDesired, pitchRateDesired, yawRateDesired);
+  }
+
+  attitudeCycles = cycleCounterGet() - start;
+}
+
+void controllerCorrectRatePID(
+       float rollRateActual, float pitchRateActual, float yawRateActual,
+       float rollRateDesired, float pitchRateDesired, float yawRateDesired)
+{
+  uint32_t start = cycleCounterGet();
+  uint32_t cycles;
+
+  active->updateRate(rollRateActual, pitchRateActual, yawRateActual,
+                     rollRateDesired, pitchRateDesired, yawRateDesired,
+                     &rollOutput, &pitchOutput, &yawOutput);
+
+  cycles = cycleCounterGet() - start + attitudeCycles;
+  attitudeCycles = 0;
+  if (active->id < CONTROLLER_STATS_SIZE)
+  {
+    execCycles[active->id] = (execCycles[active->id] * 15 + cycles) / 16;
+    if (cycles > execCyclesMax[active->id])
+    {
+      execCyclesMax[active->id] = cycles;
+    }
+  }
+}
 
 void controllerResetAllPID(void)
 {
-  pidReset(&pidRoll);
-  pidReset(&pidPitch);
-  pidReset(&pidYaw);
-  pidReset(&pidRollRate);
-  pidReset(&pidPitchRate);
-  pidReset(&pidYawRate);
+  controllerPidReset(&pidRoll);
+  controllerPidReset(&pidPitch);
+  controllerPidReset(&pidYaw);
+  active->reset(0, 0, 0);
 }
 
 void controllerGetActuatorOutput(int16_t* roll, int16_t* pitch, int16_t* yaw)
@@ -139,25 +485,58 @@ void controllerGetActuatorOutput(int16_t* roll, int16_t* pitch, int16_t* yaw)
 }
 
 PARAM_GROUP_START(pid_attitude)
-PARAM_ADD(PARAM_FLOAT, roll_kp, &pidRoll.kp)
-PARAM_ADD(PARAM_FLOAT, roll_ki, &pidRoll.ki)
-PARAM_ADD(PARAM_FLOAT, roll_kd, &pidRoll.kd)
-PARAM_ADD(PARAM_FLOAT, pitch_kp, &pidPitch.kp)
-PARAM_ADD(PARAM_FLOAT, pitch_ki, &pidPitch.ki)
-PARAM_ADD(PARAM_FLOAT, pitch_kd, &pidPitch.kd)
-PARAM_ADD(PARAM_FLOAT, yaw_kp, &pidYaw.kp)
-PARAM_ADD(PARAM_FLOAT, yaw_ki, &pidYaw.ki)
-PARAM_ADD(PARAM_FLOAT, yaw_kd, &pidYaw.kd)
+PARAM_ADD(PARAM_FLOAT, roll_kp, &gainsRoll.kp)
+PARAM_ADD(PARAM_FLOAT, roll_ki, &gainsRoll.ki)
+PARAM_ADD(PARAM_FLOAT, roll_kd, &gainsRoll.kd)
+PARAM_ADD(PARAM_FLOAT, pitch_kp, &gainsPitch.kp)
+PARAM_ADD(PARAM_FLOAT, pitch_ki, &gainsPitch.ki)
+PARAM_ADD(PARAM_FLOAT, pitch_kd, &gainsPitch.kd)
+PARAM_ADD(PARAM_FLOAT, yaw_kp, &gainsYaw.kp)
+PARAM_ADD(PARAM_FLOAT, yaw_ki, &gainsYaw.ki)
+PARAM_ADD(PARAM_FLOAT, yaw_kd, &gainsYaw.kd)
 PARAM_GROUP_STOP(pid_attitude)
 
 PARAM_GROUP_START(pid_rate)
-PARAM_ADD(PARAM_FLOAT, roll_kp, &pidRollRate.kp)
-PARAM_ADD(PARAM_FLOAT, roll_ki, &pidRollRate.ki)
-PARAM_ADD(PARAM_FLOAT, roll_kd, &pidRollRate.kd)
-PARAM_ADD(PARAM_FLOAT, pitch_kp, &pidPitchRate.kp)
-PARAM_ADD(PARAM_FLOAT, pitch_ki, &pidPitchRate.ki)
-PARAM_ADD(PARAM_FLOAT, pitch_kd, &pidPitchRate.kd)
-PARAM_ADD(PARAM_FLOAT, yaw_kp, &pidYawRate.kp)
-PARAM_ADD(PARAM_FLOAT, yaw_ki, &pidYawRate.ki)
-PARAM_ADD(PARAM_FLOAT, yaw_kd, &pidYawRate.kd)
+PARAM_ADD(PARAM_FLOAT, roll_kp, &gainsRollRate.kp)
+PARAM_ADD(PARAM_FLOAT, roll_ki, &gainsRollRate.ki)
+PARAM_ADD(PARAM_FLOAT, roll_kd, &gainsRollRate.kd)
+PARAM_ADD(PARAM_FLOAT, pitch_kp, &gainsPitchRate.kp)
+PARAM_ADD(PARAM_FLOAT, pitch_ki, &gainsPitchRate.ki)
+PARAM_ADD(PARAM_FLOAT, pitch_kd, &gainsPitchRate.kd)
+PARAM_ADD(PARAM_FLOAT, yaw_kp, &gainsYawRate.kp)
+PARAM_ADD(PARAM_FLOAT, yaw_ki, &gainsYawRate.ki)
+PARAM_ADD(PARAM_FLOAT, yaw_kd, &gainsYawRate.kd)
 PARAM_GROUP_STOP(pid_rate)
+
+PARAM_GROUP_START(controller)
+PARAM_ADD(PARAM_UINT8, type, &controllerType)
+PARAM_GROUP_STOP(controller)
+
+LOG_GROUP_START(controller)
+LOG_ADD(LOG_UINT8, type, &controllerActiveType)
+LOG_ADD(LOG_UINT32, cyc0, &execCycles[0])
+LOG_ADD(LOG_UINT32, cyc1, &execCycles[1])
+LOG_ADD(LOG_UINT32, cyc2, &execCycles[2])
+LOG_ADD(LOG_UINT32, cyc3, &execCycles[3])
+LOG_ADD(LOG_UINT32, max0, &execCyclesMax[0])
+LOG_ADD(LOG_UINT32, max1, &execCyclesMax[1])
+LOG_ADD(LOG_UINT32, max2, &execCyclesMax[2])
+LOG_ADD(LOG_UINT32, max3, &execCyclesMax[3])
+LOG_GROUP_STOP(controller)
+
+PARAM_GROUP_START(gainSched)
+PARAM_ADD(PARAM_UINT16, thrust0, &gainSchedThrust[0])
+PARAM_ADD(PARAM_UINT16, thrust1, &gainSchedThrust[1])
+PARAM_ADD(PARAM_UINT16, thrust2, &gainSchedThrust[2])
+PARAM_ADD(PARAM_FLOAT, rate0, &gainSchedRate[0])
+PARAM_ADD(PARAM_FLOAT, rate1, &gainSchedRate[1])
+PARAM_ADD(PARAM_FLOAT, rate2, &gainSchedRate[2])
+PARAM_ADD(PARAM_FLOAT, att0, &gainSchedAttitude[0])
+PARAM_ADD(PARAM_FLOAT, att1, &gainSchedAttitude[1])
+PARAM_ADD(PARAM_FLOAT, att2, &gainSchedAttitude[2])
+PARAM_GROUP_STOP(gainSched)
+
+LOG_GROUP_START(gainSched)
+LOG_ADD(LOG_FLOAT, rate, &rateScale)
+LOG_ADD(LOG_FLOAT, att, &attitudeScale)
+LOG_GROUP_STOP(gainSched)
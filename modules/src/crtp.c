@@ -39,6 +39,7 @@
 #include "info.h"
 #include "cfassert.h"
 #include "queuemonitor.h"
+#include "latency.h"
 
 static bool isInit;
 
@@ -156,6 +157,8 @@ void crtpRxTask(void *param)
   {
     if (!link->receivePacket(&p))
     {
+      latencyCrtpDispatched();
+
       if(queues[p.port])
       {
         // TODO: If full, remove one packet and then send
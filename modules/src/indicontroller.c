@@ -0,0 +1,196 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * indicontroller.c - INDI rate controller
+ */
+#include <math.h>
+
+#include "FreeRTOS.h"
+
+#include "indicontroller.h"
+#include "controller.h"
+#include "filter.h"
+#include "imu.h"
+#include "param.h"
+#include "log.h"
+
+#define INDI_AXES 3
+
+typedef struct
+{
+  lpf2pData rateFilter;   // Gyro filter
+  lpf2pData cmdFilter;    // Actuator command filter, same delay as the gyro filter
+  float rateFiltered;     // Filtered rate, deg/s
+  float rateDot;          // Angular acceleration from the filtered rate, deg/s^2
+  float cmd;              // Last actuator command
+} IndiAxis;
+
+static IndiAxis axes[INDI_AXES];
+
+// Control effectiveness in deg/s^2 per actuator unit. From the motor thrust
+// curve, arm length and inertia of a CF2 in X formation.
+static float effectiveness[INDI_AXES] = { 0.6f, 0.6f, 0.15f };
+// Rate error to desired angular acceleration, 1/s
+static float rateGain[INDI_AXES]      = { 20.0f, 20.0f, 10.0f };
+static float filterCutoff = 30.0f;      // Hz
+static float appliedCutoff;
+static bool primed;                     // False until the gyro filters hold a sample
+
+static bool isInit;
+
+static inline int16_t saturateSignedInt16(float in)
+{
+  if (in > INT16_MAX)
+    return INT16_MAX;
+  else if (in < -INT16_MAX)
+    return -INT16_MAX;
+  else
+    return (int16_t)in;
+}
+
+static void indiControllerInitFilters(void)
+{
+  int i;
+
+  for (i = 0; i < INDI_AXES; i++)
+  {
+    lpf2pInit(&axes[i].rateFilter, IMU_UPDATE_FREQ, filterCutoff);
+    lpf2pInit(&axes[i].cmdFilter, IMU_UPDATE_FREQ, filterCutoff);
+    lpf2pReset(&axes[i].rateFilter, axes[i].rateFiltered);
+    lpf2pReset(&axes[i].cmdFilter, axes[i].cmd);
+  }
+  appliedCutoff = filterCutoff;
+}
+
+void indiControllerInit(void)
+{
+  if (isInit)
+    return;
+
+  indiControllerInitFilters();
+
+  isInit = true;
+}
+
+bool indiControllerTest(void)
+{
+  return isInit;
+}
+
+static int16_t indiControllerUpdateAxis(IndiAxis* axis, float rateActual, float rateDesired,
+                                        float g, float k)
+{
+  float rateFiltered;
+  float cmdFiltered;
+  float accDesired;
+  int16_t out;
+
+  if (!primed)
+  {
+    lpf2pReset(&axis->rateFilter, rateActual);
+    axis->rateFiltered = rateActual;
+  }
+
+  rateFiltered = lpf2pApply(&axis->rateFilter, rateActual);
+  cmdFiltered = lpf2pApply(&axis->cmdFilter, axis->cmd);
+
+  axis->rateDot = (rateFiltered - axis->rateFiltered) * IMU_UPDATE_FREQ;
+  axis->rateFiltered = rateFiltered;
+
+  accDesired = k * (rateDesired - rateFiltered);
+  if (g > 0)
+  {
+    out = saturateSignedInt16(cmdFiltered + (accDesired - axis->rateDot) / g);
+  }
+  else
+  {
+    out = saturateSignedInt16(cmdFiltered);
+  }
+
+  // The saturated command is what is fed back, so there is no wind-up
+  axis->cmd = out;
+
+  return out;
+}
+
+void indiControllerUpdate(
+       float rollRateActual, float pitchRateActual, float yawRateActual,
+       float rollRateDesired, float pitchRateDesired, float yawRateDesired,
+       int16_t* roll, int16_t* pitch, int16_t* yaw)
+{
+  if (filterCutoff != appliedCutoff && filterCutoff > 0 && filterCutoff < IMU_UPDATE_FREQ / 2)
+  {
+    indiControllerInitFilters();
+  }
+
+  *roll = indiControllerUpdateAxis(&axes[0], rollRateActual, rollRateDesired,
+                                   effectiveness[0], rateGain[0]);
+  *pitch = indiControllerUpdateAxis(&axes[1], pitchRateActual, pitchRateDesired,
+                                    effectiveness[1], rateGain[1]);
+  *yaw = indiControllerUpdateAxis(&axes[2], yawRateActual, yawRateDesired,
+                                  effectiveness[2], rateGain[2]);
+  primed = true;
+}
+
+void indiControllerReset(int16_t roll, int16_t pitch, int16_t yaw)
+{
+  axes[0].cmd = roll;
+  axes[1].cmd = pitch;
+  axes[2].cmd = yaw;
+  axes[0].rateDot = 0;
+  axes[1].rateDot = 0;
+  axes[2].rateDot = 0;
+
+  // The gyro filters are seeded with the next sample
+  indiControllerInitFilters();
+  primed = false;
+}
+
+// Only replaces the rate loop, the attitude PIDs are used on top of it
+static const Controller indiController = {
+  .id = CONTROLLER_INDI,
+  .name = "INDI",
+  .init = indiControllerInit,
+  .test = indiControllerTest,
+  .reset = indiControllerReset,
+  .updateAttitude = NULL,
+  .updateRate = indiControllerUpdate,
+};
+
+CONTROLLER(indiController);
+
+PARAM_GROUP_START(indi)
+PARAM_ADD(PARAM_FLOAT, gRoll, &effectiveness[0])
+PARAM_ADD(PARAM_FLOAT, gPitch, &effectiveness[1])
+PARAM_ADD(PARAM_FLOAT, gYaw, &effectiveness[2])
+PARAM_ADD(PARAM_FLOAT, kRoll, &rateGain[0])
+PARAM_ADD(PARAM_FLOAT, kPitch, &rateGain[1])
+PARAM_ADD(PARAM_FLOAT, kYaw, &rateGain[2])
+PARAM_ADD(PARAM_FLOAT, filtHz, &filterCutoff)
+PARAM_GROUP_STOP(indi)
+
+LOG_GROUP_START(indi)
+LOG_ADD(LOG_FLOAT, accRoll, &axes[0].rateDot)
+LOG_ADD(LOG_FLOAT, accPitch, &axes[1].rateDot)
+LOG_ADD(LOG_FLOAT, accYaw, &axes[2].rateDot)
+LOG_GROUP_STOP(indi)
@@ -0,0 +1,213 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * latency.c - Tracing of the setpoint latency from radio to motors.
+ */
+#include <string.h>
+
+#include "latency.h"
+#include "crtp.h"
+#include "log.h"
+#include "param.h"
+
+/* Stages between the trace points, plus the whole path. */
+typedef enum {
+  latencyStageLink = 0, /* Link RX to CRTP dispatch. */
+  latencyStageCrtp,     /* CRTP dispatch to commander publish. */
+  latencyStageQueue,    /* Publish to stabilizer fetch. */
+  latencyStageControl,  /* Fetch to motor update. */
+  latencyStageTotal,    /* First stamp to motor update. */
+  latencyStageCount,
+} latencyStage_t;
+
+#define LATENCY_BUCKETS 8
+
+/**
+ * Upper bound in us of each histogram bucket, the last one takes the rest.
+ * Counters are 16 bit so that a full histogram fits in one log block.
+ */
+static const uint32_t bucketLimit[LATENCY_BUCKETS - 1] =
+  { 100, 200, 500, 1000, 2000, 5000, 10000 };
+
+typedef struct {
+  uint16_t count[LATENCY_BUCKETS];
+  uint16_t max; /* us, saturated */
+} latencyHistogram_t;
+
+static latencyHistogram_t histogram[latencyStageCount];
+
+/* RX task side */
+static uint32_t linkStamp;   /* Set by the link for the packet being received */
+static uint32_t rxLinkStamp; /* Link stamp of the packet being dispatched */
+static uint32_t rxCrtpStamp;
+
+/* Stabilizer task side */
+static latencyTrace_t pending;
+static bool isPending;
+
+static uint8_t loopback;
+static uint8_t reset;
+
+void latencyLinkReceived(uint32_t stamp)
+{
+  linkStamp = stamp;
+}
+
+void latencyCrtpDispatched(void)
+{
+  rxCrtpStamp = latencyStamp();
+  // Packets from links that do not stamp have no link stage
+  rxLinkStamp = linkStamp;
+  linkStamp = 0;
+}
+
+void latencyCapture(latencyTrace_t *trace, const CRTPPacket *pk, uint8_t tagOffset)
+{
+  memset(trace, 0, sizeof(*trace));
+  trace->stamp[latencyLinkRx] = rxLinkStamp;
+  trace->stamp[latencyCrtpRx] = rxCrtpStamp;
+  trace->stamp[latencyPublish] = latencyStamp();
+
+  if (pk->size >= tagOffset + sizeof(trace->tag))
+  {
+    memcpy(&trace->tag, &pk->data[tagOffset], sizeof(trace->tag));
+  }
+}
+
+void latencyFetched(const latencyTrace_t *trace)
+{
+  // A setpoint replaced before reaching the motors is not traced
+  pending = *trace;
+  pending.stamp[latencyFetch] = latencyStamp();
+  isPending = true;
+}
+
+static void latencyRecord(latencyStage_t stage, uint32_t from, uint32_t to)
+{
+  latencyHistogram_t *h = &histogram[stage];
+  uint32_t us = to - from;
+  int i;
+
+  for (i = 0; i < LATENCY_BUCKETS - 1 && us > bucketLimit[i]; i++);
+
+  if (h->count[i] < UINT16_MAX)
+  {
+    h->count[i]++;
+  }
+  if (us > h->max)
+  {
+    h->max = (us < UINT16_MAX) ? us : UINT16_MAX;
+  }
+}
+
+static void latencySendLoopback(const latencyTrace_t *trace)
+{
+  CRTPPacket pk;
+  uint16_t offset;
+  uint32_t first = trace->stamp[latencyLinkRx] ? trace->stamp[latencyLinkRx] :
+                                                 trace->stamp[latencyCrtpRx];
+  int i;
+
+  // Tag, first stamp and the offset of every following point from it
+  pk.header = CRTP_HEADER(CRTP_PORT_LINK, LATENCY_LOOPBACK_CHANNEL);
+  memcpy(&pk.data[0], &trace->tag, 4);
+  memcpy(&pk.data[4], &first, 4);
+  for (i = latencyCrtpRx; i < latencyPointCount; i++)
+  {
+    offset = trace->stamp[i] - first;
+    memcpy(&pk.data[8 + 2 * (i - latencyCrtpRx)], &offset, 2);
+  }
+  pk.size = 8 + 2 * (latencyPointCount - latencyCrtpRx);
+
+  crtpSendPacket(&pk);
+}
+
+void latencyMotorsUpdated(void)
+{
+  int i;
+
+  if (reset)
+  {
+    memset(histogram, 0, sizeof(histogram));
+    reset = 0;
+  }
+
+  if (!isPending)
+  {
+    return;
+  }
+  isPending = false;
+  pending.stamp[latencyMotors] = latencyStamp();
+
+  for (i = latencyLinkRx; i < latencyMotors; i++)
+  {
+    if (pending.stamp[i] != 0 && pending.stamp[i + 1] != 0)
+    {
+      latencyRecord((latencyStage_t)i, pending.stamp[i], pending.stamp[i + 1]);
+    }
+  }
+  latencyRecord(latencyStageTotal, pending.stamp[latencyLinkRx] ?
+                pending.stamp[latencyLinkRx] : pending.stamp[latencyCrtpRx],
+                pending.stamp[latencyMotors]);
+
+  if (loopback)
+  {
+    latencySendLoopback(&pending);
+  }
+}
+
+#define LATENCY_LOG_HISTOGRAM(STAGE) \
+  LOG_ADD(LOG_UINT16, h0, &histogram[STAGE].count[0]) \
+  LOG_ADD(LOG_UINT16, h1, &histogram[STAGE].count[1]) \
+  LOG_ADD(LOG_UINT16, h2, &histogram[STAGE].count[2]) \
+  LOG_ADD(LOG_UINT16, h3, &histogram[STAGE].count[3]) \
+  LOG_ADD(LOG_UINT16, h4, &histogram[STAGE].count[4]) \
+  LOG_ADD(LOG_UINT16, h5, &histogram[STAGE].count[5]) \
+  LOG_ADD(LOG_UINT16, h6, &histogram[STAGE].count[6]) \
+  LOG_ADD(LOG_UINT16, h7, &histogram[STAGE].count[7]) \
+  LOG_ADD(LOG_UINT16, max, &histogram[STAGE].max)
+
+LOG_GROUP_START(latLink)
+LATENCY_LOG_HISTOGRAM(latencyStageLink)
+LOG_GROUP_STOP(latLink)
+
+LOG_GROUP_START(latCrtp)
+LATENCY_LOG_HISTOGRAM(latencyStageCrtp)
+LOG_GROUP_STOP(latCrtp)
+
+LOG_GROUP_START(latQueue)
+LATENCY_LOG_HISTOGRAM(latencyStageQueue)
+LOG_GROUP_STOP(latQueue)
+
+LOG_GROUP_START(latCtrl)
+LATENCY_LOG_HISTOGRAM(latencyStageControl)
+LOG_GROUP_STOP(latCtrl)
+
+LOG_GROUP_START(latTotal)
+LATENCY_LOG_HISTOGRAM(latencyStageTotal)
+LOG_GROUP_STOP(latTotal)
+
+PARAM_GROUP_START(latency)
+PARAM_ADD(PARAM_UINT8, loopback, &loopback)
+PARAM_ADD(PARAM_UINT8, reset, &reset)
+PARAM_GROUP_STOP(latency)
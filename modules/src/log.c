@@ -31,19 +31,19 @@
 #include <errno.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <math.h>
 
 /* FreeRtos includes */
 #include "FreeRTOS.h"
 #include "task.h"
-#include "timers.h"
 #include "semphr.h"
 
 #include "config.h"
 #include "crtp.h"
 #include "log.h"
 #include "crc.h"
-#include "worker.h"
 #include "fp16.h"
+#include "namehash.h"
 
 #include "console.h"
 #include "cfassert.h"
@@ -70,6 +70,8 @@ static const uint8_t typeLength[] = {
 
 // Maximum log payload length
 #define LOG_MAX_LEN 30
+// Log data after the block id and timestamp
+#define LOG_PAYLOAD_LEN (CRTP_MAX_DATA_SIZE - 4)
 
 /* Log packet parameters storage */
 #define LOG_MAX_OPS 64
@@ -78,18 +80,64 @@ struct log_ops {
   struct log_ops * next;
   uint8_t storageType : 4;
   uint8_t logType     : 4;
+  uint16_t deadband;  // fp16, in logged units. Delta encoded blocks only
   void * variable;
+  uint32_t last;      // Last value sent, as logged. Delta encoded blocks only
+};
+
+/* Compiled copy plan step. Variables logged with their storage type are
+ * copied as is, runs of them adjacent in memory in one step. The others are
+ * converted. */
+struct log_step {
+  void * variable;
+  uint8_t length;          // Bytes written to the packet
+  uint8_t convert     : 1;
+  uint8_t storageType : 4;
+  uint8_t logType;
 };
 
 struct log_block {
   int id;
-  xTimerHandle timer;
   struct log_ops * ops;
+  uint16_t period;    // Scheduler cycles between samples, 0 when stopped
+  uint32_t due;       // Scheduler cycle of the next sample
+  uint32_t fireCycle; // Scheduler cycle the pending sample was due
+  uint8_t divCount;
+  uint8_t planStart;  // First step in logSteps
+  uint8_t planSteps;
+  uint8_t planLength; // Bytes of log data sent
+  uint8_t keyframeInterval; // Periods between full packets, 0 sends all every period
+  uint8_t sinceKeyframe;
+  bool sync;          // Sampled at the end of a control cycle into stage
+  uint32_t stageTick; // Tick of the control cycle stage was sampled in
+  uint8_t stage[LOG_PAYLOAD_LEN];
 };
 
 static struct log_ops logOps[LOG_MAX_OPS];
+// Every op compiles to at most one step, the plans of all blocks always fit
+static struct log_step logSteps[LOG_MAX_OPS];
 static struct log_block logBlocks[LOG_MAX_BLOCKS];
 static xSemaphoreHandle logLock;
+static uint8_t logRateDivider = 1;
+
+/* All running blocks are sampled by one scheduler, advanced by the control
+ * loop. Blocks are kept in a timer wheel, a block due in cycle c is in slot
+ * c % LOG_WHEEL_SLOTS, blocks in a slot that are due in a later turn of the
+ * wheel are skipped. */
+#define LOG_SCHED_CYCLE_MS    2  // One control cycle at 500Hz
+#define LOG_WHEEL_SLOTS       32
+#define LOG_SCHED_FALLBACK_MS 10 // Advance from the task if the control loop has not for this long
+
+static uint8_t logWheel[LOG_WHEEL_SLOTS]; // One bit per block
+static uint32_t logCycle;                 // Scheduler cycles since start
+static uint32_t logCycleTick;             // Tick at the start of logCycle
+static uint32_t logControlTick;           // Tick of the last control loop advance
+static uint8_t logPending;                // Blocks sampled but not yet sent
+static uint8_t logBusy;                   // Synchronous blocks staged but not yet sent
+static xTaskHandle logSchedTaskHandle;
+
+static uint32_t logMissCount; // Samples sent later than the cycle they were due
+static uint32_t logDropCount; // Samples lost to an unsent one or a full TX queue
 
 struct ops_setting {
     uint8_t logType;
@@ -103,6 +151,7 @@ struct ops_setting {
 
 #define CMD_GET_ITEM 0
 #define CMD_GET_INFO 1
+#define CMD_GET_ITEMS 2
 
 #define CONTROL_CREATE_BLOCK 0
 #define CONTROL_APPEND_BLOCK 1
@@ -110,16 +159,23 @@ struct ops_setting {
 #define CONTROL_START_BLOCK  3
 #define CONTROL_STOP_BLOCK   4
 #define CONTROL_RESET        5
+#define CONTROL_START_BLOCK_MS 6  // Period and optional phase in ms
+#define CONTROL_SET_DELTA      7  // Keyframe interval and variable deadbands
+#define CONTROL_SET_SYNC       8  // Sample in step with the control loop
 
 #define BLOCK_ID_FREE -1
 
 //Private functions
 static void logTask(void * prm);
+static void logSchedTask(void * prm);
 static void logTOCProcess(int command);
+static void logTOCSendItems(int first, int count);
 static void logControlProcess(void);
+static int variableGetIndex(int id);
+static const char * logTocGroup(int id);
+static const char * logTocName(int id);
 
 void logRunBlock(void * arg);
-void logBlockTimed(xTimerHandle timer);
 
 //These are set by the Linker
 extern struct log_s _log_start;
@@ -131,15 +187,42 @@ static int logsLen;
 static uint32_t logsCrc;
 static int logsCount = 0;
 
+/* TOC ids are one byte on the wire */
+#define LOG_TOC_MAX_ITEMS  256
+#define LOG_TOC_MAX_GROUPS 64
+
+// Built at init so that no lookup has to scan the log table
+static uint16_t logsItemEntry[LOG_TOC_MAX_ITEMS]; // TOC id to entry in logs
+static uint8_t logsItemGroup[LOG_TOC_MAX_ITEMS];  // TOC id to its group
+static uint16_t logsGroupEntry[LOG_TOC_MAX_GROUPS]; // Group to its start entry
+static int logsGroupCount = 0;
+
+/* Open addressing table from the hash of group and name to TOC id + 1, 0 is
+ * free. Twice the TOC size, so that a lookup is one hash and usually one
+ * compare. CF1 gives up some of that for RAM. */
+#ifdef PLATFORM_CF1
+  #define LOG_NAME_HASH_SIZE 256
+#else
+  #define LOG_NAME_HASH_SIZE 512
+#endif
+static uint16_t logsNameHash[LOG_NAME_HASH_SIZE];
+static NameHash logsNames = { logsNameHash, LOG_NAME_HASH_SIZE, logTocGroup, logTocName };
+
 static bool isInit = false;
 
 /* Log management functions */
 static int logAppendBlock(int id, struct ops_setting * settings, int len);
 static int logCreateBlock(unsigned char id, struct ops_setting * settings, int len);
 static int logDeleteBlock(int id);
-static int logStartBlock(int id, unsigned int period);
+static int logStartBlock(int id, unsigned int period, int phase);
 static int logStopBlock(int id);
+static int logSetDelta(int id, uint8_t keyframeInterval, int first,
+                       const uint8_t * deadbands, int count);
+static int logSetSync(int id, bool sync);
 static void logReset();
+static void logUnschedule(int i);
+static void blockRunPlan(const struct log_block * blk, uint8_t * dest);
+static void logCompilePlans(void);
 
 void logInit(void)
 {
@@ -157,8 +240,26 @@ void logInit(void)
 
   for (i=0; i<logsLen; i++)
   {
-    if(!(logs[i].type & LOG_GROUP))
+    if (logs[i].type & LOG_GROUP)
+    {
+      if (logs[i].type & LOG_START)
+      {
+        ASSERT(logsGroupCount < LOG_TOC_MAX_GROUPS);
+        logsGroupEntry[logsGroupCount++] = i;
+      }
+    }
+    else
+    {
+      // Variables past the one byte TOC id range can not be addressed
+      if (logsCount < LOG_TOC_MAX_ITEMS)
+      {
+        logsItemEntry[logsCount] = i;
+        logsItemGroup[logsCount] = logsGroupCount - 1;
+        if (!nameHashInsert(&logsNames, logsCount))
+          ASSERT_FAILED();
+      }
       logsCount++;
+    }
   }
 
   //Manually free all log blocks
@@ -168,9 +269,14 @@ void logInit(void)
   //Init data structures and set the log subsystem in a known state
   logReset();
 
+  logCycleTick = xTaskGetTickCount();
+  logControlTick = logCycleTick;
+
   //Start the log task
   xTaskCreate(logTask, LOG_TASK_NAME,
               LOG_TASK_STACKSIZE, NULL, LOG_TASK_PRI, NULL);
+  xTaskCreate(logSchedTask, LOG_SCHED_TASK_NAME,
+              LOG_SCHED_TASK_STACKSIZE, NULL, LOG_SCHED_TASK_PRI, &logSchedTaskHandle);
 
   isInit = true;
 }
@@ -189,12 +295,17 @@ void logTask(void * prm)
 	while(1) {
 		crtpReceivePacketBlock(CRTP_PORT_LOG, &p);
 
-		xSemaphoreTake(logLock, portMAX_DELAY);
+		// The TOC does not change after init. It is sent without the lock, so
+		// that a long TOC stream waiting on the link does not hold up the blocks.
 		if (p.channel==TOC_CH)
 		  logTOCProcess(p.data[0]);
+
 		if (p.channel==CONTROL_CH)
+		{
+		  xSemaphoreTake(logLock, portMAX_DELAY);
 		  logControlProcess();
-		xSemaphoreGive(logLock);
+		  xSemaphoreGive(logLock);
+		}
 	}
 }
 
@@ -221,25 +332,12 @@ void logTOCProcess(int command)
     break;
   case CMD_GET_ITEM:  //Get log variable
     LOG_DEBUG("Packet is TOC_GET_ITEM Id: %d\n", p.data[1]);
-    for (ptr=0; ptr<logsLen; ptr++) //Ptr points a group
-    {
-      if (logs[ptr].type & LOG_GROUP)
-      {
-        if (logs[ptr].type & LOG_START)
-          group = logs[ptr].name;
-        else
-          group = "";
-      }
-      else                          //Ptr points a variable
-      {
-        if (n==p.data[1])
-          break;
-        n++;
-      }
-    }
+    n = p.data[1];
+    ptr = variableGetIndex(n);
 
-    if (ptr<logsLen)
+    if (ptr >= 0)
     {
+      group = logs[logsGroupEntry[logsItemGroup[n]]].name;
       LOG_DEBUG("    Item is \"%s\":\"%s\"\n", group, logs[ptr].name);
       p.header=CRTP_HEADER(CRTP_PORT_LOG, TOC_CH);
       p.data[0]=CMD_GET_ITEM;
@@ -257,6 +355,67 @@ void logTOCProcess(int command)
       crtpSendPacket(&p);
     }
     break;
+  case CMD_GET_ITEMS:  //Get several variables per packet
+    LOG_DEBUG("Packet is TOC_GET_ITEMS Id: %d\n", p.data[1]);
+    logTOCSendItems(p.data[1], (p.size > 2) ? p.data[2] : 1);
+    break;
+  }
+}
+
+/**
+ * Stream up to count packets of TOC items, starting at id first. Each packet
+ * holds the first id and the number of items, then as many items as fit. An
+ * item is encoded as for CMD_GET_ITEM, with an empty group name when it is in
+ * the same group as the item before it in the packet. The stream ends early
+ * with a packet without items, either at the end of the TOC or at an item
+ * too long to be packed, which then has to be read with CMD_GET_ITEM.
+ */
+static void logTOCSendItems(int first, int count)
+{
+  int n = first;
+  int ptr;
+  int len;
+  int group;
+  int lastGroup;
+  int groupLen;
+  int nameLen;
+  char * groupName;
+
+  while (count-- > 0)
+  {
+    p.header=CRTP_HEADER(CRTP_PORT_LOG, TOC_CH);
+    p.data[0]=CMD_GET_ITEMS;
+    p.data[1]=n;
+    p.data[2]=0;
+    len = 3;
+    lastGroup = -1;
+
+    while (n < logsCount && n < LOG_TOC_MAX_ITEMS)
+    {
+      ptr = logsItemEntry[n];
+      group = logsItemGroup[n];
+      groupName = (group == lastGroup) ? "" : logs[logsGroupEntry[group]].name;
+      groupLen = strlen(groupName) + 1;
+      nameLen = strlen(logs[ptr].name) + 1;
+
+      if (len + 1 + groupLen + nameLen > CRTP_MAX_DATA_SIZE)
+        break;
+
+      p.data[len]=logs[ptr].type;
+      memcpy(&p.data[len+1], groupName, groupLen);
+      memcpy(&p.data[len+1+groupLen], logs[ptr].name, nameLen);
+      len += 1 + groupLen + nameLen;
+      lastGroup = group;
+      p.data[2]++;
+      n++;
+    }
+
+    p.size=len;
+    // A stream can be longer than the tx queue, wait for room in it
+    crtpSendPacketBlock(&p);
+
+    if (p.data[2] == 0)
+      break;
   }
 }
 
@@ -280,7 +439,17 @@ void logControlProcess()
       ret = logDeleteBlock( p.data[1] );
       break;
     case CONTROL_START_BLOCK:
-      ret = logStartBlock( p.data[1], p.data[2]*10);
+      ret = logStartBlock( p.data[1], p.data[2]*10, -1);
+      break;
+    case CONTROL_START_BLOCK_MS:
+      ret = logStartBlock( p.data[1], p.data[2], (p.size > 3) ? p.data[3] : -1);
+      break;
+    case CONTROL_SET_DELTA:
+      ret = logSetDelta( p.data[1], p.data[2], p.data[3], &p.data[4],
+                         (p.size > 4) ? (p.size-4)/2 : 0);
+      break;
+    case CONTROL_SET_SYNC:
+      ret = logSetSync( p.data[1], p.data[2] );
       break;
     case CONTROL_STOP_BLOCK:
       ret = logStopBlock( p.data[1] );
@@ -291,6 +460,9 @@ void logControlProcess()
       break;
   }
 
+  // Blocks are only changed here, keep their copy plans up to date
+  logCompilePlans();
+
   //Commands answer
   p.data[2] = ret;
   p.size = 3;
@@ -311,15 +483,10 @@ static int logCreateBlock(unsigned char id, struct ops_setting * settings, int l
     return ENOMEM;
 
   logBlocks[i].id = id;
-  logBlocks[i].timer = xTimerCreate( "logTimer", M2T(1000),
-                                     pdTRUE, &logBlocks[i], logBlockTimed );
   logBlocks[i].ops = NULL;
-
-  if (logBlocks[i].timer == NULL)
-  {
-	logBlocks[i].id = BLOCK_ID_FREE;
-	return ENOMEM;
-  }
+  logBlocks[i].period = 0;
+  logBlocks[i].keyframeInterval = 0;
+  logBlocks[i].sync = false;
 
   LOG_DEBUG("Added block ID %d\n", id);
 
@@ -330,7 +497,6 @@ static int blockCalcLength(struct log_block * block);
 static struct log_ops * opsMalloc();
 static void opsFree(struct log_ops * ops);
 static void blockAppendOps(struct log_block * block, struct log_ops * ops);
-static int variableGetIndex(int id);
 
 static int logAppendBlock(int id, struct ops_setting * settings, int len)
 {
@@ -379,6 +545,7 @@ static int logAppendBlock(int id, struct ops_setting * settings, int len)
       ops->variable    = logs[varId].address;
       ops->storageType = logs[varId].type;
       ops->logType     = settings[i].logType&0x0F;
+      ops->deadband    = 0;
 
       LOG_DEBUG("Appended variable %d to block %d\n", settings[i].id, id);
     } else {                     //Memory variable
@@ -386,6 +553,7 @@ static int logAppendBlock(int id, struct ops_setting * settings, int len)
       ops->variable    = (void*)(&settings[i]+1);
       ops->storageType = (settings[i].logType>>4)&0x0F;
       ops->logType     = settings[i].logType&0x0F;
+      ops->deadband    = 0;
       i += 2;
 
       LOG_DEBUG("Appended var addr 0x%x to block %d\n", (int)ops->variable, id);
@@ -420,19 +588,30 @@ static int logDeleteBlock(int id)
     ops = opsNext;
   }
 
-  if (logBlocks[i].timer != 0) {
-    xTimerStop(logBlocks[i].timer, portMAX_DELAY);
-    xTimerDelete(logBlocks[i].timer, portMAX_DELAY);
-    logBlocks[i].timer = 0;
-  }
+  logUnschedule(i);
 
   logBlocks[i].id = BLOCK_ID_FREE;
   return 0;
 }
 
-static int logStartBlock(int id, unsigned int period)
+/* Take block i out of the wheel and drop its pending sample */
+static void logUnschedule(int i)
+{
+  taskENTER_CRITICAL();
+  if (logBlocks[i].period)
+  {
+    logWheel[logBlocks[i].due % LOG_WHEEL_SLOTS] &= ~(1 << i);
+    logBlocks[i].period = 0;
+  }
+  logPending &= ~(1 << i);
+  logBusy &= ~(1 << i);
+  taskEXIT_CRITICAL();
+}
+
+static int logStartBlock(int id, unsigned int period, int phase)
 {
   int i;
+  struct log_block * blk;
 
   for (i=0; i<LOG_MAX_BLOCKS; i++)
     if (logBlocks[i].id == id) break;
@@ -444,14 +623,85 @@ static int logStartBlock(int id, unsigned int period)
 
   LOG_DEBUG("Starting block %d with period %dms\n", id, period);
 
+  blk = &logBlocks[i];
+  logUnschedule(i);
+
+  // A delta encoded block starts with a full packet
+  blk->sinceKeyframe = 0;
+
+  taskENTER_CRITICAL();
   if (period>0)
   {
-    xTimerChangePeriod(logBlocks[i].timer, M2T(period), 100);
-    xTimerStart(logBlocks[i].timer, 100);
+    blk->period = period / LOG_SCHED_CYCLE_MS;
+    if (blk->period == 0)
+      blk->period = 1;
+
+    // Without a requested phase the blocks are spread over their period
+    if (phase >= 0)
+      phase = (phase / LOG_SCHED_CYCLE_MS) % blk->period;
+    else
+      phase = (i * blk->period) / LOG_MAX_BLOCKS;
+
+    blk->divCount = 0;
+    blk->due = logCycle + 1 + phase;
+    logWheel[blk->due % LOG_WHEEL_SLOTS] |= (1 << i);
   } else {
     // single-shoot run
-    workerSchedule(logRunBlock, &logBlocks[i]);
+    blk->fireCycle = logCycle;
+    logPending |= (1 << i);
   }
+  taskEXIT_CRITICAL();
+
+  if (period == 0)
+    xTaskNotifyGive(logSchedTaskHandle);
+
+  return 0;
+}
+
+/* Turn delta encoding of a block on (keyframeInterval > 0) or off, and set
+ * the fp16 deadbands of count variables from the first:th on. */
+static int logSetDelta(int id, uint8_t keyframeInterval, int first,
+                       const uint8_t * deadbands, int count)
+{
+  int i;
+  struct log_ops * ops;
+
+  for (i=0; i<LOG_MAX_BLOCKS; i++)
+    if (logBlocks[i].id == id) break;
+
+  if (i >= LOG_MAX_BLOCKS) {
+    LOG_ERROR("Trying to set delta of block id %d that doesn't exist.\n", id);
+    return ENOENT;
+  }
+
+  logBlocks[i].keyframeInterval = keyframeInterval;
+  logBlocks[i].sinceKeyframe = 0;
+
+  for (ops = logBlocks[i].ops; ops && first > 0; ops = ops->next)
+    first--;
+
+  for (i=0; i<count && ops; i++, ops = ops->next)
+    memcpy(&ops->deadband, &deadbands[2*i], 2);
+
+  return 0;
+}
+
+/* Sample a block in step with the control loop, or whenever it is sent */
+static int logSetSync(int id, bool sync)
+{
+  int i;
+
+  for (i=0; i<LOG_MAX_BLOCKS; i++)
+    if (logBlocks[i].id == id) break;
+
+  if (i >= LOG_MAX_BLOCKS) {
+    LOG_ERROR("Trying to set sync of block id %d that doesn't exist.\n", id);
+    return ENOENT;
+  }
+
+  taskENTER_CRITICAL();
+  logBlocks[i].sync = sync;
+  taskEXIT_CRITICAL();
 
   return 0;
 }
@@ -468,39 +718,407 @@ static int logStopBlock(int id)
     return ENOENT;
   }
 
-  xTimerStop(logBlocks[i].timer, portMAX_DELAY);
+  logUnschedule(i);
 
   return 0;
 }
 
-/* This function is called by the timer subsystem */
-void logBlockTimed(xTimerHandle timer)
+/* Advance the scheduler to tick, marking the blocks that became due as
+ * pending. Synchronous blocks are returned in stage instead, to be staged
+ * first, or skipped if stage is NULL. Must be called in a critical section.
+ * Returns true if any block became pending. */
+static bool logSchedAdvance(uint32_t tick, uint8_t * stage)
 {
-  workerSchedule(logRunBlock, pvTimerGetTimerID(timer));
+  bool sampled = false;
+
+  while ((int32_t)(tick - logCycleTick) >= (int32_t)M2T(LOG_SCHED_CYCLE_MS))
+  {
+    uint8_t * slot;
+    int i;
+
+    logCycleTick += M2T(LOG_SCHED_CYCLE_MS);
+    logCycle++;
+    slot = &logWheel[logCycle % LOG_WHEEL_SLOTS];
+
+    for (i=0; i<LOG_MAX_BLOCKS && *slot; i++)
+    {
+      struct log_block * blk = &logBlocks[i];
+
+      // Blocks due in a later turn of the wheel share the slot
+      if (!(*slot & (1 << i)) || blk->due != logCycle)
+        continue;
+
+      *slot &= ~(1 << i);
+      blk->due += blk->period;
+      logWheel[blk->due % LOG_WHEEL_SLOTS] |= (1 << i);
+
+      if (++blk->divCount < logRateDivider)
+        continue;
+      blk->divCount = 0;
+
+      if (blk->sync)
+      {
+        // Without the control loop there is no cycle to be in step with
+        if (!stage)
+          continue;
+
+        // The staged sample is kept until it is sent, and so is its cycle
+        if (logBusy & (1 << i))
+        {
+          logDropCount++;
+          continue;
+        }
+        logBusy |= (1 << i);
+        blk->fireCycle = logCycle;
+        blk->stageTick = logCycleTick;
+        *stage |= (1 << i);
+      }
+      else
+      {
+        // An unsent sample is replaced, it is only read when sent
+        if (logPending & (1 << i))
+          logDropCount++;
+        blk->fireCycle = logCycle;
+        logPending |= (1 << i);
+        sampled = true;
+      }
+    }
+  }
+
+  return sampled;
 }
 
-/* Appends data to a packet if space is available; returns false on failure. */
-static bool appendToPacket(CRTPPacket * pk, const void * data, size_t n) {
-  if (pk->size <= CRTP_MAX_DATA_SIZE - n)
+/* Sample the synchronous blocks in mask into their stage buffers. Plans are
+ * only rebuilt in a critical section, so they can be run here. */
+static void logStageBlocks(uint8_t mask)
+{
+  int i;
+
+  for (i=0; i<LOG_MAX_BLOCKS; i++)
   {
-    memcpy(&pk->data[pk->size], data, n);
-    pk->size += n;
+    if (mask & (1 << i))
+      blockRunPlan(&logBlocks[i], logBlocks[i].stage);
+  }
+
+  taskENTER_CRITICAL();
+  logPending |= mask;
+  taskEXIT_CRITICAL();
+}
+
+void logSchedulerTick(uint32_t tick)
+{
+  bool sampled;
+  uint8_t stage = 0;
+
+  if (!isInit)
+    return;
+
+  taskENTER_CRITICAL();
+  logControlTick = tick;
+  sampled = logSchedAdvance(tick, &stage);
+  taskEXIT_CRITICAL();
+
+  // At the end of the control cycle, all variables come from the same one
+  if (stage)
+  {
+    logStageBlocks(stage);
+    sampled = true;
+  }
+
+  if (sampled)
+    xTaskNotifyGive(logSchedTaskHandle);
+}
+
+static void logSchedTask(void * prm)
+{
+  uint8_t pending;
+  uint32_t cycle;
+  uint32_t tick;
+  int i;
+
+  while (1)
+  {
+    ulTaskNotifyTake(pdTRUE, M2T(LOG_SCHED_FALLBACK_MS));
+
+    // The wheel is advanced by the control loop, only when that has stalled
+    // the asynchronous blocks are kept going from here. The synchronous ones
+    // are only ever staged by logSchedulerTick(), as this task can be
+    // preempted by the control loop halfway through a stage.
+    tick = xTaskGetTickCount();
+    taskENTER_CRITICAL();
+    if ((int32_t)(tick - logControlTick) >= (int32_t)M2T(LOG_SCHED_FALLBACK_MS))
+      logSchedAdvance(tick, NULL);
+    pending = logPending;
+    logPending = 0;
+    cycle = logCycle;
+    taskEXIT_CRITICAL();
+
+    for (i=0; i<LOG_MAX_BLOCKS; i++)
+    {
+      if (!(pending & (1 << i)))
+        continue;
+
+      if (logBlocks[i].fireCycle != cycle)
+        logMissCount++;
+      logRunBlock(&logBlocks[i]);
+
+      taskENTER_CRITICAL();
+      logBusy &= ~(1 << i);
+      taskEXIT_CRITICAL();
+    }
+  }
+}
+
+void logSetRateDivider(uint8_t divider)
+{
+  logRateDivider = (divider > 0) ? divider : 1;
+}
+
+/* Compile the ops of one block into steps starting at logSteps[start].
+ * Returns the number of steps. */
+static int blockCompilePlan(struct log_block * block, int start)
+{
+  struct log_ops * ops;
+  struct log_step * step = NULL;
+  bool delta = (block->keyframeInterval > 0);
+  int n = 0;
+  int length = 0;
+
+  for (ops = block->ops; ops; ops = ops->next)
+  {
+    bool convert = (ops->storageType != ops->logType);
+    int opLength = typeLength[ops->logType];
+    // Delta encoded packets start with one bit per variable
+    int bitmapLength = delta ? (n / 8 + 1) : 0;
+
+    // Items not fitting after the packet header are dropped
+    if (bitmapLength + length + opLength > LOG_PAYLOAD_LEN)
+      break;
+    length += opLength;
+
+    // Delta encoding needs a step per variable
+    if (!delta && !convert && step && !step->convert &&
+        (uint8_t *)step->variable + step->length == (uint8_t *)ops->variable)
+    {
+      step->length += opLength;
+      continue;
+    }
+
+    step = &logSteps[start + n++];
+    step->variable    = ops->variable;
+    step->length      = opLength;
+    step->convert     = convert;
+    step->storageType = ops->storageType;
+    step->logType     = ops->logType;
+  }
+
+  block->planLength = length;
+
+  return n;
+}
+
+/* Rebuild the copy plans of all blocks, packed at the start of logSteps */
+static void logCompilePlans(void)
+{
+  int i;
+  int next = 0;
+
+  // Synchronous blocks are staged from the control loop
+  taskENTER_CRITICAL();
+  for (i=0; i<LOG_MAX_BLOCKS; i++)
+  {
+    if (logBlocks[i].id == BLOCK_ID_FREE)
+      continue;
+
+    logBlocks[i].planStart = next;
+    logBlocks[i].planSteps = blockCompilePlan(&logBlocks[i], next);
+    next += logBlocks[i].planSteps;
+  }
+  taskEXIT_CRITICAL();
+}
+
+/* Write a variable that is logged with another type than it is stored in */
+static void logConvert(const struct log_step * step, uint8_t * dest)
+{
+  float variable = 0;
+  int valuei = 0;
+  float valuef = 0;
+
+  // FPU instructions must run on aligned data. Make sure it is.
+  memcpy(&variable, step->variable, typeLength[step->storageType]);
+
+  switch(step->storageType)
+  {
+    case LOG_UINT8:
+      valuei = *(uint8_t *)&variable;
+      break;
+    case LOG_INT8:
+      valuei = *(int8_t *)&variable;
+      break;
+    case LOG_UINT16:
+      valuei = *(uint16_t *)&variable;
+      break;
+    case LOG_INT16:
+      valuei = *(int16_t *)&variable;
+      break;
+    case LOG_UINT32:
+      valuei = *(uint32_t *)&variable;
+      break;
+    case LOG_INT32:
+      valuei = *(int32_t *)&variable;
+      break;
+    case LOG_FLOAT:
+      valuei = *(float *)&variable;
+      break;
+  }
+
+  if (step->logType == LOG_FLOAT || step->logType == LOG_FP16)
+  {
+    if (step->storageType == LOG_FLOAT)
+      valuef = *(float *)&variable;
+    else
+      valuef = valuei;
+
+    if (step->logType == LOG_FLOAT)
+      memcpy(dest, &valuef, 4);
+    else
+    {
+      valuei = single2half(valuef);
+      memcpy(dest, &valuei, 2);
+    }
+  }
+  else  //logType is an integer
+  {
+    memcpy(dest, &valuei, step->length);
+  }
+}
+
+/* Value of a variable as logged, for the deadband check */
+static float logValueAsFloat(uint8_t logType, uint32_t value)
+{
+  float valuef;
+
+  switch (logType)
+  {
+    case LOG_UINT8:
+      return (uint8_t)value;
+    case LOG_INT8:
+      return (int8_t)value;
+    case LOG_UINT16:
+      return (uint16_t)value;
+    case LOG_INT16:
+      return (int16_t)value;
+    case LOG_UINT32:
+      return (uint32_t)value;
+    case LOG_INT32:
+      return (int32_t)value;
+    case LOG_FLOAT:
+      memcpy(&valuef, &value, 4);
+      return valuef;
+    case LOG_FP16:
+      return half2single((uint16_t)value);
+  }
+
+  return 0;
+}
+
+static bool logDeltaExceeds(const struct log_ops * ops, uint32_t value)
+{
+  float diff;
+
+  if (value == ops->last)
+    return false;
+  if (ops->deadband == 0)
     return true;
+
+  diff = logValueAsFloat(ops->logType, value) - logValueAsFloat(ops->logType, ops->last);
+
+  return fabsf(diff) > half2single(ops->deadband);
+}
+
+/* Run the plan of a block, writing its variables as logged to dest */
+static void blockRunPlan(const struct log_block * blk, uint8_t * dest)
+{
+  const struct log_step *step;
+  const struct log_step *last;
+
+  last = &logSteps[blk->planStart + blk->planSteps];
+  for (step = &logSteps[blk->planStart]; step < last; step++)
+  {
+    if (step->convert)
+      logConvert(step, dest);
+    else
+      memcpy(dest, step->variable, step->length);
+    dest += step->length;
   }
-  else return false;
 }
 
-/* This function is usually called by the worker subsystem */
+/* Fill a delta encoded packet from the block's variables as logged in
+ * values: a bitmap of the variables sent, bit i of byte i/8 for the i:th
+ * variable, followed by the variables that changed by more than their
+ * deadband. Keyframes send all. Returns false if none changed. */
+static bool blockFillDelta(struct log_block * blk, CRTPPacket * pk,
+                           const uint8_t * values)
+{
+  const struct log_step * step = &logSteps[blk->planStart];
+  struct log_ops * ops = blk->ops;
+  int bitmapLength = (blk->planSteps + 7) / 8;
+  uint8_t * bitmap = &pk->data[4];
+  uint8_t * dest = bitmap + bitmapLength;
+  bool keyframe = (blk->sinceKeyframe == 0);
+  bool changed = keyframe;
+  int i;
+
+  memset(bitmap, 0, bitmapLength);
+
+  for (i=0; i<blk->planSteps; i++, step++, ops = ops->next)
+  {
+    uint32_t value = 0;
+
+    memcpy(&value, values, step->length);
+    values += step->length;
+
+    if (keyframe || logDeltaExceeds(ops, value))
+    {
+      bitmap[i / 8] |= 1 << (i % 8);
+      memcpy(dest, &value, step->length);
+      dest += step->length;
+      ops->last = value;
+      changed = true;
+    }
+  }
+
+  if (++blk->sinceKeyframe >= blk->keyframeInterval)
+    blk->sinceKeyframe = 0;
+
+  pk->size = dest - pk->data;
+
+  return changed;
+}
+
+/* This function is called by the log scheduler task */
 void logRunBlock(void * arg)
 {
   struct log_block *blk = arg;
-  struct log_ops *ops = blk->ops;
+  uint8_t values[LOG_PAYLOAD_LEN];
+  const uint8_t *src;
   static CRTPPacket pk;
   unsigned int timestamp;
+  bool staged;
+  bool send = true;
 
   xSemaphoreTake(logLock, portMAX_DELAY);
 
-  timestamp = ((long long)xTaskGetTickCount())/portTICK_RATE_MS;
+  // The block may have been deleted since it was sampled
+  if (blk->id == BLOCK_ID_FREE)
+  {
+    xSemaphoreGive(logLock);
+    return;
+  }
+
+  // Staged blocks carry the time of the control cycle they were sampled in
+  staged = (logBusy & (1 << (blk - logBlocks))) != 0;
+  timestamp = ((long long)(staged ? blk->stageTick : xTaskGetTickCount()))/portTICK_RATE_MS;
 
   pk.header = CRTP_HEADER(CRTP_PORT_LOG, LOG_CH);
   pk.size = 4;
@@ -509,65 +1127,26 @@ void logRunBlock(void * arg)
   pk.data[2] = (timestamp>>8)&0x0ff;
   pk.data[3] = (timestamp>>16)&0x0ff;
 
-  while (ops)
+  if (staged)
   {
-    float variable;
-    int valuei = 0;
-    float valuef = 0;
-
-    // FPU instructions must run on aligned data. Make sure it is.
-    variable = *(float *)ops->variable;
-
-    switch(ops->storageType)
-    {
-      case LOG_UINT8:
-        valuei = *(uint8_t *)&variable;
-        break;
-      case LOG_INT8:
-        valuei = *(int8_t *)&variable;
-        break;
-      case LOG_UINT16:
-        valuei = *(uint16_t *)&variable;
-        break;
-      case LOG_INT16:
-        valuei = *(int16_t *)&variable;
-        break;
-      case LOG_UINT32:
-        valuei = *(uint32_t *)&variable;
-        break;
-      case LOG_INT32:
-        valuei = *(int32_t *)&variable;
-        break;
-      case LOG_FLOAT:
-        valuei = *(float *)&variable;
-        break;
-    }
-
-    if (ops->logType == LOG_FLOAT || ops->logType == LOG_FP16)
-    {
-      if (ops->storageType == LOG_FLOAT)
-        valuef = *(float *)&variable;
-      else
-        valuef = valuei;
-
-      // Try to append the next item to the packet.  If we run out of space,
-      // drop this and subsequent items.
-      if (ops->logType == LOG_FLOAT)
-      {
-        if (!appendToPacket(&pk, &valuef, 4)) break;
-      }
-      else
-      {
-        valuei = single2half(valuef);
-        if (!appendToPacket(&pk, &valuei, 2)) break;
-      }
-    }
-    else  //logType is an integer
-    {
-      if (!appendToPacket(&pk, &valuei, typeLength[ops->logType])) break;
-    }
+    src = blk->stage;
+  }
+  else
+  {
+    // Without delta encoding the plan writes straight into the packet
+    src = blk->keyframeInterval ? values : &pk.data[4];
+    blockRunPlan(blk, (uint8_t *)src);
+  }
 
-    ops = ops->next;
+  if (blk->keyframeInterval)
+  {
+    send = blockFillDelta(blk, &pk, src);
+  }
+  else
+  {
+    if (src != &pk.data[4])
+      memcpy(&pk.data[4], src, blk->planLength);
+    pk.size = 4 + blk->planLength;
   }
 
   xSemaphoreGive(logLock);
@@ -579,31 +1158,28 @@ void logRunBlock(void * arg)
     logReset();
     crtpReset();
   }
-  else
+  else if (send && !crtpSendPacket(&pk))
   {
-    crtpSendPacket(&pk);
+    logDropCount++;
   }
 }
 
 static int variableGetIndex(int id)
 {
-  int i;
-  int n=0;
+  if (id < 0 || id >= logsCount || id >= LOG_TOC_MAX_ITEMS)
+    return -1;
 
-  for (i=0; i<logsLen; i++)
-  {
-    if(!(logs[i].type & LOG_GROUP))
-    {
-      if(n==id)
-        break;
-      n++;
-    }
-  }
+  return logsItemEntry[id];
+}
 
-  if (i>=logsLen)
-    return -1;
+static const char * logTocGroup(int id)
+{
+  return logs[logsGroupEntry[logsItemGroup[id]]].name;
+}
 
-  return i;
+static const char * logTocName(int id)
+{
+  return logs[logsItemEntry[id]].name;
 }
 
 static struct log_ops * opsMalloc()
@@ -668,7 +1244,16 @@ static void logReset(void)
 
   //Force free all the log block objects
   for(i=0; i<LOG_MAX_BLOCKS; i++)
+  {
     logBlocks[i].id = BLOCK_ID_FREE;
+    logBlocks[i].period = 0;
+  }
+
+  taskENTER_CRITICAL();
+  memset(logWheel, 0, sizeof(logWheel));
+  logPending = 0;
+  logBusy = 0;
+  taskEXIT_CRITICAL();
 
   //Force free the log ops
   for (i=0; i<LOG_MAX_OPS; i++)
@@ -678,19 +1263,7 @@ static void logReset(void)
 /* Public API to access log TOC from within the copter */
 int logGetVarId(char* group, char* name)
 {
-  int i;
-  char * currgroup = "";
-
-  for(i=0; i<logsLen; i++)
-  {
-    if (logs[i].type & LOG_GROUP) {
-      if (logs[i].type & LOG_START)
-        currgroup = logs[i].name;
-    } if ((!strcmp(group, currgroup)) && (!strcmp(name, logs[i].name)))
-      return i;
-  }
-
-  return -1;
+  return variableGetIndex(nameHashFind(&logsNames, group, name));
 }
 
 int logGetInt(int varid)
@@ -741,3 +1314,27 @@ unsigned int logGetUint(int varid)
 {
   return (unsigned int)logGetInt(varid);
 }
+
+int logGetVarIdFromToc(int tocId)
+{
+  return variableGetIndex(tocId);
+}
+
+int logGetType(int varid)
+{
+  ASSERT(varid >= 0);
+
+  return logs[varid].type;
+}
+
+void* logGetAddress(int varid)
+{
+  ASSERT(varid >= 0);
+
+  return logs[varid].address;
+}
+
+LOG_GROUP_START(logSched)
+LOG_ADD(LOG_UINT32, miss, &logMissCount)
+LOG_ADD(LOG_UINT32, drop, &logDropCount)
+LOG_GROUP_STOP(logSched)
@@ -0,0 +1,204 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * lqrcontroller.c - LQR attitude controller
+ */
+#include "FreeRTOS.h"
+
+#include "lqrcontroller.h"
+#include "controller.h"
+#include "lqrgains.h"
+#include "imu.h"
+#include "param.h"
+#include "log.h"
+
+// Same limits as the attitude PID integrators, deg*s
+static const float integralLimit[LQR_INPUTS] = { 20.0f, 20.0f, 360.0f };
+
+static float gain[LQR_INPUTS][LQR_STATES] = LQR_GAINS;
+static float state[LQR_STATES];
+static int16_t output[LQR_INPUTS];
+
+static bool isInit;
+
+static inline int16_t saturateSignedInt16(float in)
+{
+  if (in > INT16_MAX)
+    return INT16_MAX;
+  else if (in < -INT16_MAX)
+    return -INT16_MAX;
+  else
+    return (int16_t)in;
+}
+
+void lqrControllerInit(void)
+{
+  if (isInit)
+    return;
+
+  lqrControllerReset();
+
+  isInit = true;
+}
+
+bool lqrControllerTest(void)
+{
+  return isInit;
+}
+
+void lqrControllerSetAttitudeError(float roll, float pitch, float yaw)
+{
+  state[3] = roll;
+  state[4] = pitch;
+  state[5] = yaw;
+}
+
+void lqrControllerUpdate(float rollRateError, float pitchRateError, float yawRateError,
+                         int16_t* roll, int16_t* pitch, int16_t* yaw)
+{
+  int i, j;
+
+  state[6] = rollRateError;
+  state[7] = pitchRateError;
+  state[8] = yawRateError;
+
+  for (i = 0; i < LQR_INPUTS; i++)
+  {
+    state[i] += state[3 + i] * IMU_UPDATE_DT;
+    if (state[i] > integralLimit[i])
+      state[i] = integralLimit[i];
+    else if (state[i] < -integralLimit[i])
+      state[i] = -integralLimit[i];
+  }
+
+  for (i = 0; i < LQR_INPUTS; i++)
+  {
+    float u = 0;
+
+    for (j = 0; j < LQR_STATES; j++)
+    {
+      u += gain[i][j] * state[j];
+    }
+    output[i] = saturateSignedInt16(u);
+  }
+
+  *roll = output[0];
+  *pitch = output[1];
+  *yaw = output[2];
+}
+
+void lqrControllerReset(void)
+{
+  int i;
+
+  for (i = 0; i < LQR_STATES; i++)
+  {
+    state[i] = 0;
+  }
+}
+
+static void lqrControllerUpdateAttitude(
+       float eulerRollActual, float eulerPitchActual, float eulerYawActual,
+       float eulerRollDesired, float eulerPitchDesired, float eulerYawDesired,
+       float* rollRateDesired, float* pitchRateDesired, float* yawRateDesired)
+{
+  float yawError = eulerYawDesired - eulerYawActual;
+
+  if (yawError > 180.0f)
+    yawError -= 360.0f;
+  else if (yawError < -180.0f)
+    yawError += 360.0f;
+
+  // The attitude and rate loops are closed together, only keep the error
+  lqrControllerSetAttitudeError(eulerRollDesired - eulerRollActual,
+                                eulerPitchDesired - eulerPitchActual, yawError);
+  *rollRateDesired = 0;
+  *pitchRateDesired = 0;
+  *yawRateDesired = 0;
+}
+
+static void lqrControllerUpdateRate(
+       float rollRateActual, float pitchRateActual, float yawRateActual,
+       float rollRateDesired, float pitchRateDesired, float yawRateDesired,
+       int16_t* roll, int16_t* pitch, int16_t* yaw)
+{
+  lqrControllerUpdate(rollRateDesired - rollRateActual, pitchRateDesired - pitchRateActual,
+                      yawRateDesired - yawRateActual, roll, pitch, yaw);
+}
+
+static void lqrControllerResetTo(int16_t roll, int16_t pitch, int16_t yaw)
+{
+  lqrControllerReset();
+}
+
+static const Controller lqrController = {
+  .id = CONTROLLER_LQR,
+  .name = "LQR",
+  .init = lqrControllerInit,
+  .test = lqrControllerTest,
+  .reset = lqrControllerResetTo,
+  .updateAttitude = lqrControllerUpdateAttitude,
+  .updateRate = lqrControllerUpdateRate,
+};
+
+CONTROLLER(lqrController);
+
+// Gains are named k<input><state>
+PARAM_GROUP_START(lqr)
+PARAM_ADD(PARAM_FLOAT, k00, &gain[0][0])
+PARAM_ADD(PARAM_FLOAT, k01, &gain[0][1])
+PARAM_ADD(PARAM_FLOAT, k02, &gain[0][2])
+PARAM_ADD(PARAM_FLOAT, k03, &gain[0][3])
+PARAM_ADD(PARAM_FLOAT, k04, &gain[0][4])
+PARAM_ADD(PARAM_FLOAT, k05, &gain[0][5])
+PARAM_ADD(PARAM_FLOAT, k06, &gain[0][6])
+PARAM_ADD(PARAM_FLOAT, k07, &gain[0][7])
+PARAM_ADD(PARAM_FLOAT, k08, &gain[0][8])
+PARAM_ADD(PARAM_FLOAT, k10, &gain[1][0])
+PARAM_ADD(PARAM_FLOAT, k11, &gain[1][1])
+PARAM_ADD(PARAM_FLOAT, k12, &gain[1][2])
+PARAM_ADD(PARAM_FLOAT, k13, &gain[1][3])
+PARAM_ADD(PARAM_FLOAT, k14, &gain[1][4])
+PARAM_ADD(PARAM_FLOAT, k15, &gain[1][5])
+PARAM_ADD(PARAM_FLOAT, k16, &gain[1][6])
+PARAM_ADD(PARAM_FLOAT, k17, &gain[1][7])
+PARAM_ADD(PARAM_FLOAT, k18, &gain[1][8])
+PARAM_ADD(PARAM_FLOAT, k20, &gain[2][0])
+PARAM_ADD(PARAM_FLOAT, k21, &gain[2][1])
+PARAM_ADD(PARAM_FLOAT, k22, &gain[2][2])
+PARAM_ADD(PARAM_FLOAT, k23, &gain[2][3])
+PARAM_ADD(PARAM_FLOAT, k24, &gain[2][4])
+PARAM_ADD(PARAM_FLOAT, k25, &gain[2][5])
+PARAM_ADD(PARAM_FLOAT, k26, &gain[2][6])
+PARAM_ADD(PARAM_FLOAT, k27, &gain[2][7])
+PARAM_ADD(PARAM_FLOAT, k28, &gain[2][8])
+PARAM_GROUP_STOP(lqr)
+
+LOG_GROUP_START(lqr)
+LOG_ADD(LOG_FLOAT, iRoll, &state[0])
+LOG_ADD(LOG_FLOAT, iPitch, &state[1])
+LOG_ADD(LOG_FLOAT, iYaw, &state[2])
+LOG_ADD(LOG_INT16, roll, &output[0])
+LOG_ADD(LOG_INT16, pitch, &output[1])
+LOG_ADD(LOG_INT16, yaw, &output[2])
+LOG_GROUP_STOP(lqr)
@@ -40,6 +40,8 @@
 #include "mem.h"
 #include "ow.h"
 #include "eeprom.h"
+#include "trajectory.h"
+#include "blackbox.h"
 #ifdef PLATFORM_CF2
 #include "ledring12.h"
 #endif
@@ -60,6 +62,8 @@
 
 // Maximum log payload length
 #define MEM_MAX_LEN 30
+// Read data follows the id, address and status
+#define MEM_READ_MAX_LEN (CRTP_MAX_DATA_SIZE - 6)
 
 #define SETTINGS_CH     0
 #define READ_CH         1
@@ -74,20 +78,32 @@
 #define NBR_EEPROM      1
 #endif
 
-#define EEPROM_ID       0x00
 #ifdef PLATFORM_CF1
   #define NBR_LEDMEM      0
   uint8_t ledringmem[1];
 #else
   #define NBR_LEDMEM      1
 #endif
-#define LEDMEM_ID       0x01
-
-#define NBR_STATIC_MEM  (NBR_EEPROM + NBR_LEDMEM)
+#define NBR_TRAJMEM     1
+#define NBR_BLACKBOXMEM 1
+
+/* Memory ids are dense: the EEPROM and LED ring of the platform, the 1-wire
+ * memories and then the virtual memories. Memories added later go last so
+ * that the ids of the existing ones, the decks in particular, don't move. */
+typedef enum {
+  memNone,
+  memEeprom,
+  memLedRing,
+  memOneWire,
+  memTrajectory,
+  memBlackbox,
+} memKind_t;
 
 #define MEM_TYPE_EEPROM 0x00
 #define MEM_TYPE_OW     0x01
 #define MEM_TYPE_LED12  0x10
+#define MEM_TYPE_TRAJ   0x12
+#define MEM_TYPE_BLACKBOX 0x13
 
 
 //Private functions
@@ -95,6 +111,7 @@ static void memTask(void * prm);
 static void memSettingsProcess(int command);
 static void memWriteProcess(void);
 static void memReadProcess(void);
+static memKind_t memGetKind(uint8_t memId, uint8_t * owId);
 
 
 static bool isInit = false;
@@ -128,6 +145,33 @@ bool memTest(void)
   return isInit;
 }
 
+static memKind_t memGetKind(uint8_t memId, uint8_t * owId)
+{
+  if (memId < NBR_EEPROM)
+    return memEeprom;
+  memId -= NBR_EEPROM;
+
+  if (memId < NBR_LEDMEM)
+    return memLedRing;
+  memId -= NBR_LEDMEM;
+
+  if (memId < nbrOwMems)
+  {
+    *owId = memId;
+    return memOneWire;
+  }
+  memId -= nbrOwMems;
+
+  if (memId < NBR_TRAJMEM)
+    return memTrajectory;
+  memId -= NBR_TRAJMEM;
+
+  if (memId < NBR_BLACKBOXMEM)
+    return memBlackbox;
+
+  return memNone;
+}
+
 void memTask(void * param)
 {
 	crtpInitTaskQueue(CRTP_PORT_MEM);
@@ -156,14 +200,16 @@ void memTask(void * param)
 void memSettingsProcess(int command)
 {
   uint8_t memId;
-  
+  uint8_t owId = 0;
+  memKind_t kind;
+
   switch (command)
   {
     case CMD_GET_NBR:
       p.header = CRTP_HEADER(CRTP_PORT_MEM, SETTINGS_CH);
       p.size = 2;
       p.data[0] = CMD_GET_NBR;
-      p.data[1] = nbrOwMems + NBR_STATIC_MEM;
+      p.data[1] = NBR_EEPROM + NBR_LEDMEM + nbrOwMems + NBR_TRAJMEM + NBR_BLACKBOXMEM;
       crtpSendPacket(&p);
       break;
 
@@ -173,8 +219,9 @@ void memSettingsProcess(int command)
       p.size = 2;
       p.data[0] = CMD_GET_INFO;
       p.data[1] = memId;
+      kind = memGetKind(memId, &owId);
       // No error code if we fail, just send an empty packet back
-      if (memId == EEPROM_ID)
+      if (kind == memEeprom)
       {
         // Memory type (eeprom)
         p.data[2] = MEM_TYPE_EEPROM;
@@ -186,7 +233,7 @@ void memSettingsProcess(int command)
         memcpy(&p.data[7], eepromSerialNum.data, 8);
         p.size += 8;
       }
-      else if (memId == LEDMEM_ID)
+      else if (kind == memLedRing)
       {
         // Memory type virtual ledring mem
         p.data[2] = MEM_TYPE_LED12;
@@ -198,9 +245,33 @@ void memSettingsProcess(int command)
         memcpy(&p.data[7], eepromSerialNum.data, 8); //TODO
         p.size += 8;
       }
-      else
+      else if (kind == memTrajectory)
       {
-        if (owGetinfo(memId - NBR_STATIC_MEM, &serialNbr))
+        // Memory type virtual trajectory mem
+        p.data[2] = MEM_TYPE_TRAJ;
+        p.size += 1;
+        // Size of the memory
+        memSize = trajectoryMemGetSize();
+        memcpy(&p.data[3], &memSize, 4);
+        p.size += 4;
+        memcpy(&p.data[7], eepromSerialNum.data, 8); //TODO
+        p.size += 8;
+      }
+      else if (kind == memBlackbox)
+      {
+        // Memory type virtual black box recording
+        p.data[2] = MEM_TYPE_BLACKBOX;
+        p.size += 1;
+        // Size of the memory
+        memSize = blackboxMemGetSize();
+        memcpy(&p.data[3], &memSize, 4);
+        p.size += 4;
+        memcpy(&p.data[7], eepromSerialNum.data, 8); //TODO
+        p.size += 8;
+      }
+      else if (kind == memOneWire)
+      {
+        if (owGetinfo(owId, &serialNbr))
         {
           // Memory type (1-wire)
           p.data[2] = MEM_TYPE_OW;
@@ -225,6 +296,8 @@ void memReadProcess()
   uint8_t readLen = p.data[5];
   uint32_t memAddr;
   uint8_t status = 0;
+  uint8_t owId = 0;
+  memKind_t kind = memGetKind(memId, &owId);
 
   memcpy(&memAddr, &p.data[1], 4);
 
@@ -232,7 +305,11 @@ void memReadProcess()
   p.header = CRTP_HEADER(CRTP_PORT_MEM, READ_CH);
   // Dont' touch the first 5 bytes, they will be the same.
 
-  if (memId == EEPROM_ID)
+  if (readLen > MEM_READ_MAX_LEN)
+  {
+    status = EIO;
+  }
+  else if (kind == memEeprom)
   {
     if (memAddr + readLen <= EEPROM_SIZE &&
         eepromReadBuffer(&p.data[6], memAddr, readLen))
@@ -240,7 +317,7 @@ void memReadProcess()
     else
       status = EIO;
   }
-  else if (memId == LEDMEM_ID)
+  else if (kind == memLedRing)
   {
     if (memAddr + readLen <= sizeof(ledringmem) &&
         memcpy(&p.data[6], &(ledringmem[memAddr]), readLen))
@@ -248,15 +325,32 @@ void memReadProcess()
     else
       status = EIO;
   }
-  else
+  else if (kind == memTrajectory)
+  {
+    if (trajectoryMemRead(memAddr, readLen, &p.data[6]))
+      status = 0;
+    else
+      status = EIO;
+  }
+  else if (kind == memBlackbox)
+  {
+    if (blackboxMemRead(memAddr, readLen, &p.data[6]))
+      status = 0;
+    else
+      status = EIO;
+  }
+  else if (kind == memOneWire)
   {
-    memId = memId - NBR_STATIC_MEM;
     if (memAddr + readLen <= OW_MAX_SIZE &&
-        owRead(memId, memAddr, readLen, &p.data[6]))
+        owRead(owId, memAddr, readLen, &p.data[6]))
       status = 0;
     else
       status = EIO;
   }
+  else
+  {
+    status = EIO;
+  }
 
 #if 0
   {
@@ -284,6 +378,8 @@ void memWriteProcess()
   uint8_t writeLen;
   uint32_t memAddr;
   uint8_t status = 0;
+  uint8_t owId = 0;
+  memKind_t kind = memGetKind(memId, &owId);
 
   memcpy(&memAddr, &p.data[1], 4);
   writeLen = p.size - 5;
@@ -291,7 +387,11 @@ void memWriteProcess()
   MEM_DEBUG("Packet is MEM WRITE\n");
   p.header = CRTP_HEADER(CRTP_PORT_MEM, WRITE_CH);
   // Dont' touch the first 5 bytes, they will be the same.
-  if (memId == EEPROM_ID)
+  if (p.size < 5)
+  {
+    status = EIO;
+  }
+  else if (kind == memEeprom)
   {
     if (memAddr + writeLen <= EEPROM_SIZE &&
         eepromWriteBuffer(&p.data[5], memAddr, writeLen))
@@ -299,7 +399,7 @@ void memWriteProcess()
     else
       status = EIO;
   }
-  else if(memId == LEDMEM_ID)
+  else if (kind == memLedRing)
   {
     if ((memAddr + writeLen) <= sizeof(ledringmem))
     {
@@ -311,15 +411,32 @@ void memWriteProcess()
       MEM_DEBUG("\LED write failed! addr:%i, led:%i\n", memAddr, writeLen);
     }
   }
-  else
+  else if (kind == memTrajectory)
+  {
+    if (trajectoryMemWrite(memAddr, writeLen, &p.data[5]))
+      status = 0;
+    else
+      status = EIO;
+  }
+  else if (kind == memBlackbox)
+  {
+    if (blackboxMemWrite(memAddr, writeLen, &p.data[5]))
+      status = 0;
+    else
+      status = EIO;
+  }
+  else if (kind == memOneWire)
   {
-    memId = memId - NBR_STATIC_MEM;
     if (memAddr + writeLen <= OW_MAX_SIZE &&
-        owWrite(memId, memAddr, writeLen, &p.data[5]))
+        owWrite(owId, memAddr, writeLen, &p.data[5]))
       status = 0;
     else
       status = EIO;
   }
+  else
+  {
+    status = EIO;
+  }
 
   p.data[5] = status;
   p.size = 6;
@@ -34,7 +34,9 @@
 #include "crtp.h"
 #include "param.h"
 #include "crc.h"
+#include "namehash.h"
 #include "console.h"
+#include "cfassert.h"
 
 
 #define TOC_CH 0
@@ -48,12 +50,14 @@
 
 #define CMD_GET_ITEM 0
 #define CMD_GET_INFO 1
+#define CMD_GET_ITEMS 2
 
 #define MISC_SETBYNAME 0
 
 //Private functions
 static void paramTask(void * prm);
 void paramTOCProcess(int command);
+static void paramTOCSendItems(int first, int count);
 
 
 //These are set by the Linker
@@ -64,6 +68,8 @@ extern struct param_s _param_stop;
 static void paramWriteProcess(int id, void*);
 static void paramReadProcess(int id);
 static int variableGetIndex(int id);
+static const char * paramTocGroup(int id);
+static const char * paramTocName(int id);
 static char paramWriteByNameProcess(char* group, char* name, int type, void *valptr);
 
 //Pointer to the parameters list and length of it
@@ -72,6 +78,27 @@ static int paramsLen;
 static uint32_t paramsCrc;
 static int paramsCount = 0;
 
+/* TOC ids are one byte on the wire */
+#define PARAM_TOC_MAX_ITEMS  256
+#define PARAM_TOC_MAX_GROUPS 64
+
+// Built at init so that no lookup has to scan the parameter table
+static uint16_t paramsItemEntry[PARAM_TOC_MAX_ITEMS]; // TOC id to entry in params
+static uint8_t paramsItemGroup[PARAM_TOC_MAX_ITEMS];  // TOC id to its group
+static uint16_t paramsGroupEntry[PARAM_TOC_MAX_GROUPS]; // Group to its start entry
+static int paramsGroupCount = 0;
+
+/* Open addressing table from the hash of group and name to TOC id + 1, 0 is
+ * free. Twice the TOC size, so that a lookup is one hash and usually one
+ * compare. CF1 gives up some of that for RAM. */
+#ifdef PLATFORM_CF1
+  #define PARAM_NAME_HASH_SIZE 256
+#else
+  #define PARAM_NAME_HASH_SIZE 512
+#endif
+static uint16_t paramsNameHash[PARAM_NAME_HASH_SIZE];
+static NameHash paramsNames = { paramsNameHash, PARAM_NAME_HASH_SIZE, paramTocGroup, paramTocName };
+
 static bool isInit = false;
 
 void paramInit(void)
@@ -87,8 +114,26 @@ void paramInit(void)
 
   for (i=0; i<paramsLen; i++)
   {
-    if(!(params[i].type & PARAM_GROUP))
+    if (params[i].type & PARAM_GROUP)
+    {
+      if (params[i].type & PARAM_START)
+      {
+        ASSERT(paramsGroupCount < PARAM_TOC_MAX_GROUPS);
+        paramsGroupEntry[paramsGroupCount++] = i;
+      }
+    }
+    else
+    {
+      // Parameters past the one byte TOC id range can not be addressed
+      if (paramsCount < PARAM_TOC_MAX_ITEMS)
+      {
+        paramsItemEntry[paramsCount] = i;
+        paramsItemGroup[paramsCount] = paramsGroupCount - 1;
+        if (!nameHashInsert(&paramsNames, paramsCount))
+          ASSERT_FAILED();
+      }
       paramsCount++;
+    }
   }
 
 
@@ -172,25 +217,12 @@ void paramTOCProcess(int command)
     crtpSendPacket(&p);
     break;
   case CMD_GET_ITEM:  //Get param variable
-    for (ptr=0; ptr<paramsLen; ptr++) //Ptr points a group
-    {
-      if (params[ptr].type & PARAM_GROUP)
-      {
-        if (params[ptr].type & PARAM_START)
-          group = params[ptr].name;
-        else
-          group = "";
-      }
-      else                          //Ptr points a variable
-      {
-        if (n==p.data[1])
-          break;
-        n++;
-      }
-    }
+    n = p.data[1];
+    ptr = variableGetIndex(n);
 
-    if (ptr<paramsLen)
+    if (ptr >= 0)
     {
+      group = params[paramsGroupEntry[paramsItemGroup[n]]].name;
       p.header=CRTP_HEADER(CRTP_PORT_PARAM, TOC_CH);
       p.data[0]=CMD_GET_ITEM;
       p.data[1]=n;
@@ -206,6 +238,66 @@ void paramTOCProcess(int command)
       crtpSendPacket(&p);
     }
     break;
+  case CMD_GET_ITEMS:  //Get several variables per packet
+    paramTOCSendItems(p.data[1], (p.size > 2) ? p.data[2] : 1);
+    break;
+  }
+}
+
+/**
+ * Stream up to count packets of TOC items, starting at id first. Each packet
+ * holds the first id and the number of items, then as many items as fit. An
+ * item is encoded as for CMD_GET_ITEM, with an empty group name when it is in
+ * the same group as the item before it in the packet. The stream ends early
+ * with a packet without items, either at the end of the TOC or at an item
+ * too long to be packed, which then has to be read with CMD_GET_ITEM.
+ */
+static void paramTOCSendItems(int first, int count)
+{
+  int n = first;
+  int ptr;
+  int len;
+  int group;
+  int lastGroup;
+  int groupLen;
+  int nameLen;
+  char * groupName;
+
+  while (count-- > 0)
+  {
+    p.header=CRTP_HEADER(CRTP_PORT_PARAM, TOC_CH);
+    p.data[0]=CMD_GET_ITEMS;
+    p.data[1]=n;
+    p.data[2]=0;
+    len = 3;
+    lastGroup = -1;
+
+    while (n < paramsCount && n < PARAM_TOC_MAX_ITEMS)
+    {
+      ptr = paramsItemEntry[n];
+      group = paramsItemGroup[n];
+      groupName = (group == lastGroup) ? "" : params[paramsGroupEntry[group]].name;
+      groupLen = strlen(groupName) + 1;
+      nameLen = strlen(params[ptr].name) + 1;
+
+      if (len + 1 + groupLen + nameLen > CRTP_MAX_DATA_SIZE)
+        break;
+
+      p.data[len]=params[ptr].type;
+      memcpy(&p.data[len+1], groupName, groupLen);
+      memcpy(&p.data[len+1+groupLen], params[ptr].name, nameLen);
+      len += 1 + groupLen + nameLen;
+      lastGroup = group;
+      p.data[2]++;
+      n++;
+    }
+
+    p.size=len;
+    // A stream can be longer than the tx queue, wait for room in it
+    crtpSendPacketBlock(&p);
+
+    if (p.data[2] == 0)
+      break;
   }
 }
 
@@ -247,27 +339,17 @@ static void paramWriteProcess(int ident, void* valptr)
   crtpSendPacket(&p);
 }
 
+static int paramGetIndexByName(char* group, char* name)
+{
+  return variableGetIndex(nameHashFind(&paramsNames, group, name));
+}
+
 static char paramWriteByNameProcess(char* group, char* name, int type, void *valptr) {
   int ptr;
-  char *pgroup = "";
 
-  for (ptr=0; ptr<paramsLen; ptr++) //Ptr points a group
-  {
-    if (params[ptr].type & PARAM_GROUP)
-    {
-      if (params[ptr].type & PARAM_START)
-        pgroup = params[ptr].name;
-      else
-        pgroup = "";
-    }
-    else                          //Ptr points a variable
-    {
-      if (!strcmp(params[ptr].name, name) && !strcmp(pgroup, group))
-        break;
-    }
-  }
+  ptr = paramGetIndexByName(group, name);
 
-  if (ptr >= paramsLen) {
+  if (ptr < 0) {
     return ENOENT;
   }
 
@@ -340,21 +422,18 @@ static void paramReadProcess(int ident)
 
 static int variableGetIndex(int id)
 {
-  int i;
-  int n=0;
+  if (id < 0 || id >= paramsCount || id >= PARAM_TOC_MAX_ITEMS)
+    return -1;
 
-  for (i=0; i<paramsLen; i++)
-  {
-    if(!(params[i].type & PARAM_GROUP))
-    {
-      if(n==id)
-        break;
-      n++;
-    }
-  }
+  return paramsItemEntry[id];
+}
 
-  if (i>=paramsLen)
-    return -1;
+static const char * paramTocGroup(int id)
+{
+  return params[paramsGroupEntry[paramsItemGroup[id]]].name;
+}
 
-  return i;
+static const char * paramTocName(int id)
+{
+  return params[paramsItemEntry[id]].name;
 }
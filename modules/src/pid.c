@@ -26,6 +26,7 @@
  */
 
 #include "pid.h"
+#include "fixmath.h"
 
 void pidInit(PidObject* pid, const float desired, const float kp,
              const float ki, const float kd, const float dt)
@@ -136,3 +137,89 @@ void pidSetKd(PidObject* pid, const float kd)
 void pidSetDt(PidObject* pid, const float dt) {
     pid->dt = dt;
 }
+
+void pidFixInit(PidFixObject* pid, const float desired, const float kp,
+                const float ki, const float kd, const float dt)
+{
+  pidFixReset(pid);
+  pid->desired   = FIX_FROM_FLOAT(desired, FIX_Q16);
+  pid->kp        = FIX_FROM_FLOAT(kp, FIX_Q16);
+  pid->ki        = FIX_FROM_FLOAT(ki, FIX_Q16);
+  pid->kd        = FIX_FROM_FLOAT(kd, FIX_Q16);
+  pid->iLimit    = FIX_FROM_FLOAT(DEFAULT_PID_INTEGRATION_LIMIT, FIX_Q16);
+  pid->iLimitLow = -pid->iLimit;
+  pid->dt        = FIX_FROM_FLOAT(dt, FIX_Q30);
+  pid->invDt     = FIX_FROM_FLOAT(1.0f / dt, FIX_Q16);
+}
+
+void pidFixSetIntegralLimit(PidFixObject* pid, const float limit)
+{
+  pid->iLimit = FIX_FROM_FLOAT(limit, FIX_Q16);
+}
+
+void pidFixReset(PidFixObject* pid)
+{
+  pid->error     = 0;
+  pid->prevError = 0;
+  pid->integ     = 0;
+}
+
+int32_t pidFixUpdate(PidFixObject* pid, const int32_t measured, const bool updateError)
+{
+  int64_t output;
+
+  if (updateError)
+  {
+    pid->error = pid->desired - measured;
+  }
+
+  pid->integ += fixMul(pid->error, pid->dt, FIX_Q30);
+  if (pid->integ > pid->iLimit)
+  {
+    pid->integ = pid->iLimit;
+  }
+  else if (pid->integ < pid->iLimitLow)
+  {
+    pid->integ = pid->iLimitLow;
+  }
+
+  // All terms in Q32 before the final shift, the derivative is scaled by
+  // 1/dt last so that small error changes are not lost.
+  output = (int64_t)pid->kp * pid->error + (int64_t)pid->ki * pid->integ;
+  output += (((int64_t)pid->kd * (pid->error - pid->prevError)) >> FIX_Q16) * pid->invDt;
+  output >>= FIX_Q16;
+
+  pid->prevError = pid->error;
+
+  if (output > INT32_MAX)
+    return INT32_MAX;
+  else if (output < -INT32_MAX)
+    return -INT32_MAX;
+  else
+    return (int32_t)output;
+}
+
+void pidFixSetDesired(PidFixObject* pid, const int32_t desired)
+{
+  pid->desired = desired;
+}
+
+void pidFixSetError(PidFixObject* pid, const int32_t error)
+{
+  pid->error = error;
+}
+
+void pidFixSetKp(PidFixObject* pid, const float kp)
+{
+  pid->kp = FIX_FROM_FLOAT(kp, FIX_Q16);
+}
+
+void pidFixSetKi(PidFixObject* pid, const float ki)
+{
+  pid->ki = FIX_FROM_FLOAT(ki, FIX_Q16);
+}
+
+void pidFixSetKd(PidFixObject* pid, const float kd)
+{
+  pid->kd = FIX_FROM_FLOAT(kd, FIX_Q16);
+}
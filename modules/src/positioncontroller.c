@@ -0,0 +1,231 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * positioncontroller.c - Cascaded position/velocity controller
+ */
+#include <math.h>
+
+#include "FreeRTOS.h"
+
+#include "positioncontroller.h"
+#include "imu.h"
+#include "pid.h"
+#include "param.h"
+#include "log.h"
+
+#define GRAVITY_MAGNITUDE 9.81f
+#define RAD_TO_DEG        (180.0f / (float)M_PI)
+#define DEG_TO_RAD        ((float)M_PI / 180.0f)
+
+static PidObject pidX;   // Position to velocity
+static PidObject pidY;
+static PidObject pidZ;
+static PidObject pidVX;  // Velocity to acceleration
+static PidObject pidVY;
+static PidObject pidVZ;
+
+// Velocity estimated from successive position estimates
+static float vx;
+static float vy;
+static float vz;
+static positionEstimate_t lastEstimate;
+static bool hasLastEstimate;
+
+// Outputs, for logging
+static float vxDesired;
+static float vyDesired;
+static float vzDesired;
+static float rollOut;
+static float pitchOut;
+static uint16_t thrustOut;
+
+// Params
+static uint8_t enable       = 0;
+static uint8_t rateDivider  = 10;     // 500Hz/10 = 50Hz
+static float xyKp           = 1.0f;   // (m/s)/m
+static float zKp            = 1.5f;
+static float vxyKp          = 2.0f;   // (m/s^2)/(m/s)
+static float vxyKi          = 0.5f;
+static float vzKp           = 2.0f;
+static float vzKi           = 0.5f;
+static float velFF          = 1.0f;   // Setpoint velocity feed-forward gain
+static float velAlpha       = 0.7f;   // Velocity estimate smoothing
+static float maxVel         = 1.0f;   // m/s
+static float maxAngle       = 20.0f;  // deg
+static uint16_t hoverThrust = 43000;
+static uint16_t minThrust   = 20000;
+static uint16_t maxThrust   = 60000;
+
+static bool isInit;
+
+static float constrain(float value, const float minVal, const float maxVal)
+{
+  return fminf(maxVal, fmaxf(minVal, value));
+}
+
+void positionControllerInit(void)
+{
+  if (isInit)
+    return;
+
+  pidInit(&pidX, 0, xyKp, 0, 0, rateDivider / (float)IMU_UPDATE_FREQ);
+  pidInit(&pidY, 0, xyKp, 0, 0, rateDivider / (float)IMU_UPDATE_FREQ);
+  pidInit(&pidZ, 0, zKp, 0, 0, rateDivider / (float)IMU_UPDATE_FREQ);
+  pidInit(&pidVX, 0, vxyKp, vxyKi, 0, rateDivider / (float)IMU_UPDATE_FREQ);
+  pidInit(&pidVY, 0, vxyKp, vxyKi, 0, rateDivider / (float)IMU_UPDATE_FREQ);
+  pidInit(&pidVZ, 0, vzKp, vzKi, 0, rateDivider / (float)IMU_UPDATE_FREQ);
+  pidSetIntegralLimit(&pidVX, 2.0f);
+  pidSetIntegralLimitLow(&pidVX, -2.0f);
+  pidSetIntegralLimit(&pidVY, 2.0f);
+  pidSetIntegralLimitLow(&pidVY, -2.0f);
+  pidSetIntegralLimit(&pidVZ, 2.0f);
+  pidSetIntegralLimitLow(&pidVZ, -2.0f);
+
+  isInit = true;
+}
+
+bool positionControllerTest(void)
+{
+  return isInit;
+}
+
+bool positionControllerIsEnabled(void)
+{
+  return enable != 0;
+}
+
+uint32_t positionControllerGetRateDivider(void)
+{
+  return (rateDivider > 0) ? rateDivider : 1;
+}
+
+static void positionControllerUpdateGains(PidObject* pid, float kp, float ki, float dt)
+{
+  pidSetKp(pid, kp);
+  pidSetKi(pid, ki);
+  pidSetDt(pid, dt);
+}
+
+static void positionControllerUpdateVelocity(const positionEstimate_t* estimate)
+{
+  if (hasLastEstimate && estimate->timestamp != lastEstimate.timestamp)
+  {
+    float dt = (estimate->timestamp - lastEstimate.timestamp) / (float)configTICK_RATE_HZ;
+
+    vx = vx * velAlpha + (estimate->x - lastEstimate.x) / dt * (1 - velAlpha);
+    vy = vy * velAlpha + (estimate->y - lastEstimate.y) / dt * (1 - velAlpha);
+    vz = vz * velAlpha + (estimate->z - lastEstimate.z) / dt * (1 - velAlpha);
+  }
+
+  lastEstimate = *estimate;
+  hasLastEstimate = true;
+}
+
+void positionControllerUpdate(const positionEstimate_t* estimate, const trajectoryPoint_t* setpoint,
+                              float yaw, float dt, float* roll, float* pitch, uint16_t* thrust)
+{
+  float ax, ay, az;
+  float cosYaw = cosf(yaw * DEG_TO_RAD);
+  float sinYaw = sinf(yaw * DEG_TO_RAD);
+
+  positionControllerUpdateVelocity(estimate);
+
+  // Gains and rate are params, refresh them
+  positionControllerUpdateGains(&pidX, xyKp, 0, dt);
+  positionControllerUpdateGains(&pidY, xyKp, 0, dt);
+  positionControllerUpdateGains(&pidZ, zKp, 0, dt);
+  positionControllerUpdateGains(&pidVX, vxyKp, vxyKi, dt);
+  positionControllerUpdateGains(&pidVY, vxyKp, vxyKi, dt);
+  positionControllerUpdateGains(&pidVZ, vzKp, vzKi, dt);
+
+  // Position to velocity, with feed-forward of the setpoint velocity
+  pidSetDesired(&pidX, setpoint->x);
+  vxDesired = constrain(pidUpdate(&pidX, estimate->x, true) + velFF * setpoint->vx, -maxVel, maxVel);
+  pidSetDesired(&pidY, setpoint->y);
+  vyDesired = constrain(pidUpdate(&pidY, estimate->y, true) + velFF * setpoint->vy, -maxVel, maxVel);
+  pidSetDesired(&pidZ, setpoint->z);
+  vzDesired = constrain(pidUpdate(&pidZ, estimate->z, true) + velFF * setpoint->vz, -maxVel, maxVel);
+
+  // Velocity to world frame acceleration
+  pidSetDesired(&pidVX, vxDesired);
+  ax = pidUpdate(&pidVX, vx, true);
+  pidSetDesired(&pidVY, vyDesired);
+  ay = pidUpdate(&pidVY, vy, true);
+  pidSetDesired(&pidVZ, vzDesired);
+  az = pidUpdate(&pidVZ, vz, true);
+
+  // Rotate the horizontal acceleration into the body frame and tilt for it
+  pitchOut = constrain(atanf((ax * cosYaw + ay * sinYaw) / GRAVITY_MAGNITUDE) * RAD_TO_DEG,
+                       -maxAngle, maxAngle);
+  rollOut = constrain(atanf((ax * sinYaw - ay * cosYaw) / GRAVITY_MAGNITUDE) * RAD_TO_DEG,
+                      -maxAngle, maxAngle);
+  thrustOut = (uint16_t)constrain(hoverThrust * (1.0f + az / GRAVITY_MAGNITUDE), minThrust, maxThrust);
+
+  *roll = rollOut;
+  *pitch = pitchOut;
+  *thrust = thrustOut;
+}
+
+void positionControllerReset(void)
+{
+  pidReset(&pidX);
+  pidReset(&pidY);
+  pidReset(&pidZ);
+  pidReset(&pidVX);
+  pidReset(&pidVY);
+  pidReset(&pidVZ);
+  vx = 0;
+  vy = 0;
+  vz = 0;
+  hasLastEstimate = false;
+}
+
+PARAM_GROUP_START(posCtrl)
+PARAM_ADD(PARAM_UINT8, enable, &enable)
+PARAM_ADD(PARAM_UINT8, rateDiv, &rateDivider)
+PARAM_ADD(PARAM_FLOAT, xyKp, &xyKp)
+PARAM_ADD(PARAM_FLOAT, zKp, &zKp)
+PARAM_ADD(PARAM_FLOAT, vxyKp, &vxyKp)
+PARAM_ADD(PARAM_FLOAT, vxyKi, &vxyKi)
+PARAM_ADD(PARAM_FLOAT, vzKp, &vzKp)
+PARAM_ADD(PARAM_FLOAT, vzKi, &vzKi)
+PARAM_ADD(PARAM_FLOAT, velFF, &velFF)
+PARAM_ADD(PARAM_FLOAT, velAlpha, &velAlpha)
+PARAM_ADD(PARAM_FLOAT, maxVel, &maxVel)
+PARAM_ADD(PARAM_FLOAT, maxAngle, &maxAngle)
+PARAM_ADD(PARAM_UINT16, hoverThrust, &hoverThrust)
+PARAM_ADD(PARAM_UINT16, minThrust, &minThrust)
+PARAM_ADD(PARAM_UINT16, maxThrust, &maxThrust)
+PARAM_GROUP_STOP(posCtrl)
+
+LOG_GROUP_START(posCtrl)
+LOG_ADD(LOG_FLOAT, vx, &vx)
+LOG_ADD(LOG_FLOAT, vy, &vy)
+LOG_ADD(LOG_FLOAT, vz, &vz)
+LOG_ADD(LOG_FLOAT, vxDes, &vxDesired)
+LOG_ADD(LOG_FLOAT, vyDes, &vyDesired)
+LOG_ADD(LOG_FLOAT, vzDes, &vzDesired)
+LOG_ADD(LOG_FLOAT, roll, &rollOut)
+LOG_ADD(LOG_FLOAT, pitch, &pitchOut)
+LOG_ADD(LOG_UINT16, thrust, &thrustOut)
+LOG_GROUP_STOP(posCtrl)
@@ -25,7 +25,9 @@
  */
 #include <math.h>
 
+#include "config.h"
 #include "sensfusion6.h"
+#include "fixmath.h"
 #include "param.h"
 
 #define M_PI_F ((float) M_PI)
@@ -54,10 +56,39 @@ float q1 = 0.0f;
 float q2 = 0.0f;
 float q3 = 0.0f;  // quaternion of sensor frame relative to auxiliary frame
 
+#ifdef CONTROL_FIXED_POINT
+  #ifdef MADWICK_QUATERNION_IMU
+    #error "CONTROL_FIXED_POINT is only implemented for the Mahony filter"
+  #endif
+
+  #define DEG_TO_RAD_Q32  74961321 // pi / 180 in Q32
+
+  // Fixed point state. Quaternion in Q29, q0..q3 are float copies of it.
+  static int32_t fq0 = FIX_ONE(FIX_Q29);
+  static int32_t fq1 = 0;
+  static int32_t fq2 = 0;
+  static int32_t fq3 = 0;
+  static int32_t fIntegralFBx = 0; // Integral feedback in rad/s, Q29
+  static int32_t fIntegralFBy = 0;
+  static int32_t fIntegralFBz = 0;
+
+  // Fixed point copies of dt and of the gain params. They are converted again
+  // only when one of the float values changes, so that the filter update
+  // itself runs without float arithmetic.
+  static uint32_t fDtBits;
+  static uint32_t fTwoKpBits;
+  static uint32_t fTwoKiBits;
+  static int32_t fHalfDt;   // dt / 2, Q36
+  static int32_t fTwoKp;    // Q24
+  static int32_t fTwoKiDt;  // twoKi * dt, Q29
+#endif
+
 static bool isInit;
 
+#ifndef CONTROL_FIXED_POINT
 // TODO: Make math util file
 static float invSqrt(float x);
+#endif
 
 void sensfusion6Init()
 {
@@ -148,6 +179,114 @@ void sensfusion6UpdateQ(float gx, float gy, float gz, float ax, float ay, float
   q2 *= recipNorm;
   q3 *= recipNorm;
 }
+#elif defined(CONTROL_FIXED_POINT)
+// Fixed point version of the Mahony filter below, for targets without FPU.
+// Only the conversion of the outputs, and of dt and the gains when they
+// change, uses float.
+//
+// Q24 is used for rates in rad/s and Q29 for the quaternion, the unit
+// vectors and the rotation per update (rate * dt / 2).
+static void sensfusion6FixUpdateConstants(float dt)
+{
+  union { float f; uint32_t u; } d = { .f = dt }, kp = { .f = twoKp }, ki = { .f = twoKi };
+
+  if (d.u == fDtBits && kp.u == fTwoKpBits && ki.u == fTwoKiBits)
+    return;
+
+  fDtBits = d.u;
+  fTwoKpBits = kp.u;
+  fTwoKiBits = ki.u;
+  fHalfDt = FIX_FROM_FLOAT(0.5f * dt, 36);
+  fTwoKp = FIX_FROM_FLOAT(twoKp, FIX_Q24);
+  fTwoKiDt = FIX_FROM_FLOAT(twoKi * dt, FIX_Q29);
+}
+
+void sensfusion6UpdateQ(float gx, float gy, float gz, float ax, float ay, float az, float dt)
+{
+  int32_t gxq, gyq, gzq;
+  int32_t axq, ayq, azq;
+  int32_t halfvx, halfvy, halfvz;
+  int32_t halfex, halfey, halfez;
+  int32_t qa, qb, qc;
+  int32_t norm2, recipNorm;
+
+  sensfusion6FixUpdateConstants(dt);
+
+  // deg/s in Q16 times pi/180 in Q32 gives rad/s in Q24
+  gxq = fixMul(fixFromFloat(gx, FIX_Q16), DEG_TO_RAD_Q32, 24);
+  gyq = fixMul(fixFromFloat(gy, FIX_Q16), DEG_TO_RAD_Q32, 24);
+  gzq = fixMul(fixFromFloat(gz, FIX_Q16), DEG_TO_RAD_Q32, 24);
+
+  axq = fixFromFloat(ax, FIX_Q16);
+  ayq = fixFromFloat(ay, FIX_Q16);
+  azq = fixFromFloat(az, FIX_Q16);
+
+  // Compute feedback only if accelerometer measurement valid
+  if (axq != 0 || ayq != 0 || azq != 0)
+  {
+    // Normalise accelerometer measurement
+    fixNormalize3(&axq, &ayq, &azq);
+
+    // Estimated direction of gravity
+    halfvx = fixMul(fq1, fq3, FIX_Q29) - fixMul(fq0, fq2, FIX_Q29);
+    halfvy = fixMul(fq0, fq1, FIX_Q29) + fixMul(fq2, fq3, FIX_Q29);
+    halfvz = fixMul(fq0, fq0, FIX_Q29) - FIX_ONE(FIX_Q29) / 2 + fixMul(fq3, fq3, FIX_Q29);
+
+    // Error is sum of cross product between estimated and measured direction of gravity
+    halfex = fixMul(ayq, halfvz, FIX_Q29) - fixMul(azq, halfvy, FIX_Q29);
+    halfey = fixMul(azq, halfvx, FIX_Q29) - fixMul(axq, halfvz, FIX_Q29);
+    halfez = fixMul(axq, halfvy, FIX_Q29) - fixMul(ayq, halfvx, FIX_Q29);
+
+    // Compute and apply integral feedback if enabled
+    if(fTwoKiDt > 0)
+    {
+      fIntegralFBx += fixMul(fTwoKiDt, halfex, FIX_Q29);
+      fIntegralFBy += fixMul(fTwoKiDt, halfey, FIX_Q29);
+      fIntegralFBz += fixMul(fTwoKiDt, halfez, FIX_Q29);
+      gxq += fIntegralFBx >> (FIX_Q29 - FIX_Q24);
+      gyq += fIntegralFBy >> (FIX_Q29 - FIX_Q24);
+      gzq += fIntegralFBz >> (FIX_Q29 - FIX_Q24);
+    }
+    else
+    {
+      fIntegralFBx = 0; // prevent integral windup
+      fIntegralFBy = 0;
+      fIntegralFBz = 0;
+    }
+
+    // Apply proportional feedback
+    gxq += fixMul(fTwoKp, halfex, FIX_Q29);
+    gyq += fixMul(fTwoKp, halfey, FIX_Q29);
+    gzq += fixMul(fTwoKp, halfez, FIX_Q29);
+  }
+
+  // Integrate rate of change of quaternion, Q24 * Q36 >> 31 gives Q29
+  gxq = fixMul(gxq, fHalfDt, 31);
+  gyq = fixMul(gyq, fHalfDt, 31);
+  gzq = fixMul(gzq, fHalfDt, 31);
+  qa = fq0;
+  qb = fq1;
+  qc = fq2;
+  fq0 += (-fixMul(qb, gxq, FIX_Q29) - fixMul(qc, gyq, FIX_Q29) - fixMul(fq3, gzq, FIX_Q29));
+  fq1 += (fixMul(qa, gxq, FIX_Q29) + fixMul(qc, gzq, FIX_Q29) - fixMul(fq3, gyq, FIX_Q29));
+  fq2 += (fixMul(qa, gyq, FIX_Q29) - fixMul(qb, gzq, FIX_Q29) + fixMul(fq3, gxq, FIX_Q29));
+  fq3 += (fixMul(qa, gzq, FIX_Q29) + fixMul(qb, gyq, FIX_Q29) - fixMul(qc, gxq, FIX_Q29));
+
+  // Normalise quaternion. The norm stays close to one so one Newton step,
+  // 1/sqrt(n) ~ (3 - n) / 2, is enough.
+  norm2 = fixMul(fq0, fq0, FIX_Q29) + fixMul(fq1, fq1, FIX_Q29) +
+          fixMul(fq2, fq2, FIX_Q29) + fixMul(fq3, fq3, FIX_Q29);
+  recipNorm = (3 * FIX_ONE(FIX_Q29) - norm2) / 2;
+  fq0 = fixMul(fq0, recipNorm, FIX_Q29);
+  fq1 = fixMul(fq1, recipNorm, FIX_Q29);
+  fq2 = fixMul(fq2, recipNorm, FIX_Q29);
+  fq3 = fixMul(fq3, recipNorm, FIX_Q29);
+
+  q0 = FIX_TO_FLOAT(fq0, FIX_Q29);
+  q1 = FIX_TO_FLOAT(fq1, FIX_Q29);
+  q2 = FIX_TO_FLOAT(fq2, FIX_Q29);
+  q3 = FIX_TO_FLOAT(fq3, FIX_Q29);
+}
 #else // MAHONY_QUATERNION_IMU
 // Madgwick's implementation of Mayhony's AHRS algorithm.
 // See: http://www.x-io.co.uk/open-source-ahrs-with-x-imu
@@ -257,19 +396,20 @@ float sensfusion6GetAccZWithoutGravity(const float ax, const float ay, const flo
   // (A dot G) / |G| - 1G (|G| = 1) -> (A dot G) - 1G
   return ((ax*gx + ay*gy + az*gz) - 1.0);
 }
+
+#ifndef CONTROL_FIXED_POINT
 //---------------------------------------------------------------------------------------------------
 // Fast inverse square-root
 // See: http://en.wikipedia.org/wiki/Fast_inverse_square_root
 float invSqrt(float x)
 {
   float halfx = 0.5f * x;
-  float y = x;
-  long i = *(long*)&y;
-  i = 0x5f3759df - (i>>1);
-  y = *(float*)&i;
-  y = y * (1.5f - (halfx * y * y));
-  return y;
+  union { float f; int32_t i; } y = { .f = x };
+  y.i = 0x5f3759df - (y.i>>1);
+  y.f = y.f * (1.5f - (halfx * y.f * y.f));
+  return y.f;
 }
+#endif
 
 
 
@@ -0,0 +1,115 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * setpointinterp.c - Interpolation of setpoints between commander packets.
+ */
+
+#include <stddef.h>
+
+#include "FreeRTOS.h"
+
+#include "param.h"
+#include "setpointinterp.h"
+#include "stm32fxxx.h"
+
+/* Packet intervals longer than this are not interpolated over (link lost and recovered). */
+#define SETPOINT_INTERP_MAX_INTERVAL  M2T(500)
+
+static uint8_t interpMode = setpointInterpInterpolate;
+static uint16_t interpHorizon = 20; /* Maximum extrapolation time in ms */
+
+/**
+ * Initialize a setpoint interpolation object.
+ *
+ * @param interp    The interpolation object.
+ * @param timestamp Current time in ticks.
+ */
+void setpointInterpInit(setpointInterp_t *interp, uint32_t timestamp)
+{
+  assert_param(interp != NULL);
+
+  interp->prevTime = timestamp;
+  interp->latestTime = timestamp;
+}
+
+/**
+ * Register the arrival of a new setpoint.
+ *
+ * @param interp    The interpolation object.
+ * @param timestamp Arrival time of the setpoint in ticks.
+ */
+void setpointInterpNewSample(setpointInterp_t *interp, uint32_t timestamp)
+{
+  interp->prevTime = interp->latestTime;
+  interp->latestTime = timestamp;
+}
+
+/**
+ * Get the blend factor between the previous and the latest setpoint.
+ *
+ * In interpolation mode the factor goes from 0 to 1 during one packet
+ * interval after the latest setpoint arrived, so the output is delayed by
+ * at most one interval but never leaves the range of the received setpoints.
+ * In extrapolation mode the factor is 1 when the setpoint arrives and grows
+ * with the elapsed time, limited by the horizon.
+ *
+ * @param interp The interpolation object.
+ * @param now    Current time in ticks.
+ *
+ * @return Blend factor to use with setpointInterpApply().
+ */
+float setpointInterpGetFactor(const setpointInterp_t *interp, uint32_t now)
+{
+  uint32_t interval = interp->latestTime - interp->prevTime;
+  uint32_t elapsed = now - interp->latestTime;
+  uint32_t horizon = M2T(interpHorizon);
+
+  if (interval == 0 || interval > SETPOINT_INTERP_MAX_INTERVAL)
+  {
+    return 1.0f;
+  }
+
+  switch (interpMode)
+  {
+    case setpointInterpInterpolate:
+      if (elapsed >= interval)
+      {
+        return 1.0f;
+      }
+      return (float)elapsed / interval;
+    case setpointInterpExtrapolate:
+      if (elapsed > horizon)
+      {
+        elapsed = horizon;
+      }
+      return 1.0f + (float)elapsed / interval;
+    case setpointInterpOff: // Fall through
+    default:
+      return 1.0f;
+  }
+}
+
+PARAM_GROUP_START(setpoint)
+PARAM_ADD(PARAM_UINT8, interpMode, &interpMode)
+PARAM_ADD(PARAM_UINT16, horizon, &interpHorizon)
+PARAM_GROUP_STOP(setpoint)
@@ -39,6 +39,7 @@
 #include "log.h"
 #include "sound.h"
 #include "buzzer.h"
+#include "stabilizer.h"
 
 /**
  * Credit to http://tny.cz/e525c1b2 for supplying the tones
@@ -256,19 +257,17 @@ static void siren(uint32_t counter, uint32_t * mi, Melody * melody)
   buzzerOn(siren_freq);
 }
 
-static int pitchid;
-static int rollid;
 static int pitch;
 static int roll;
 static int tilt_freq;
 static int tilt_ratio;
 static void tilt(uint32_t counter, uint32_t * mi, Melody * melody)
 {
-  pitchid = logGetVarId("stabilizer", "pitch");
-  rollid = logGetVarId("stabilizer", "roll");
+  vehicleState_t state;
 
-  pitch = logGetInt(pitchid);
-  roll = logGetInt(rollid);
+  stabilizerGetState(&state);
+  pitch = state.pitch;
+  roll = state.roll;
   tilt_freq = 0;
   tilt_ratio = 127;
 
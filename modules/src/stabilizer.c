@@ -41,6 +41,14 @@
 #include "pid.h"
 #include "param.h"
 #include "sitaw.h"
+#include "trajectory.h"
+#include "positioncontroller.h"
+#include "autotune.h"
+#include "proximity.h"
+#include "cyclecounter.h"
+#include "seqlock.h"
+#include "latency.h"
+#include "blackbox.h"
 #ifdef PLATFORM_CF1
   #include "ms5611.h"
 #else
@@ -64,6 +72,25 @@
 #define ALTHOLD_UPDATE_RATE_DIVIDER  5 // 500hz/5 = 100hz for barometer measurements
 #define ALTHOLD_UPDATE_DT  (float)(1.0 / (IMU_UPDATE_FREQ / ALTHOLD_UPDATE_RATE_DIVIDER))   // 500hz
 
+// Deadline monitoring, misses are evaluated once per window
+#define DEADLINE_WINDOW_CYCLES  IMU_UPDATE_FREQ // 1s at the full rate
+
+/**
+ * Degradation levels stepped through when control deadlines keep being
+ * missed. Each level includes the previous ones.
+ */
+typedef enum
+{
+  degradeNone          = 0,
+  degradeSkipOptional  = 1, // Skip magnetometer, gain scheduling and autotune
+  degradeLowerLogRate  = 2, // Divide the log block rates
+  degradeLand          = 3, // Ramp the thrust down to zero
+} DegradeLevel;
+
+// Idle (landed with zero thrust) stuff
+#define IDLE_UPDATE_RATE_DIVIDER  5 // 500hz/5 = 100hz while idle
+#define IDLE_UPDATE_DT  (float)(1.0 / (IMU_UPDATE_FREQ / IDLE_UPDATE_RATE_DIVIDER))
+
 static Axis3f gyro; // Gyro axis data in deg/s
 static Axis3f acc;  // Accelerometer axis data in mG
 static Axis3f mag;  // Magnetometer axis data in testla
@@ -85,6 +112,7 @@ static float asl;         // smoothed asl
 static float aslRaw;      // raw asl
 static float aslLong;     // long term asl
 static float aslRef;      // asl reference (ie. offset)
+static float altEstimate; // asl fused with the proximity range, used by altitude hold
 
 // Altitude hold variables
 static PidObject altHoldPID;  // Used for altitute hold mode. I gets reset when the bat status changes
@@ -132,8 +160,48 @@ static float autoTOTargetAdjust    = 1.5f;  // Meters to add to altHoldTarget to
 static float autoTOThresh          = 0.97f; // Threshold for when to deactivate auto Take-Off. A value of 0.97 means 97% of the target altitude adjustment.
 #endif
 
+// Range (proximity sensor) fusion in altitude hold
+static float rangeHeight;                 // Last valid tilt compensated height above ground in m
+static float rangeWeight           = 0.0; // Current weight of rangeHeight in altEstimate, 0 = baro only
+static float rangeOffset           = 0.0; // Offset from asl to the range frame
+static float rangeMin              = 0.2; // Range below this is invalid (MaxSonar minimum is 0.15 m)
+static float rangeMax              = 3.0; // Range above this is invalid
+static float rangeMaxTilt          = 0.85; // Minimum cos(tilt) for the range to be valid
+static float rangeOffsetAlpha      = 0.98; // Smoothing of the asl to range offset
+static float rangeBlendTime        = 0.5;  // Time in s to blend between baro and range
+
+// Deadline monitor
+static uint32_t deadlineMisses;            // Total number of cycles started late
+static uint16_t deadlineWorst;             // Worst lateness in ms
+static uint32_t deadlineWindowMisses;      // Misses in the current window
+static uint32_t deadlineWindowCycles;      // Cycles in the current window
+static uint8_t degradeLevel = degradeNone; // Current DegradeLevel
+static uint32_t degradeEvents;             // Number of degradation level changes
+static float landThrust;                   // Thrust limit while landing
+static uint16_t deadlineMissThreshold = 10;    // Misses per window that steps up the degradation
+static uint8_t deadlineLogDivider     = 4;     // Log rate divider from degradeLowerLogRate
+static float deadlineLandRate         = 10000; // Thrust decrease per second while landing
+
+// CPU cycles spent in the control path, from the DWT cycle counter
+static uint32_t fusionCycles;    // sensfusion6 update and Euler angles
+static uint32_t attitudeCycles;  // Attitude PIDs
+static uint32_t rateCycles;      // Rate PIDs
+
+// Low power idle while landed
+static bool isIdle;                 // True when the estimate runs at the idle rate
+static uint8_t idleEnable   = 1;    // Allow entering idle
+static uint16_t idleDelay   = 1000; // Time in ms with zero thrust before entering idle
+
 static float carefreeFrontAngle = 0; // carefree front angle that is set
 
+static trajectoryPoint_t trajectorySetpoint; // Position setpoint sampled from the onboard trajectory
+static bool trajectoryActive;                 // True when trajectorySetpoint is valid
+
+static bool positionActive;          // True when the position controller sets the attitude
+static float positionRollDesired;    // Roll setpoint from the position controller
+static float positionPitchDesired;   // Pitch setpoint from the position controller
+static uint16_t positionThrust;      // Thrust from the position controller
+
 uint16_t actuatorThrust;  // Actuator output for thrust base
 int16_t  actuatorRoll;    // Actuator output roll compensation
 int16_t  actuatorPitch;   // Actuator output pitch compensation
@@ -144,13 +212,25 @@ uint32_t motorPowerM2;  // Motor 2 power output (16bit value used: 0 - 65535)
 uint32_t motorPowerM3;  // Motor 3 power output (16bit value used: 0 - 65535)
 uint32_t motorPowerM4;  // Motor 4 power output (16bit value used: 0 - 65535)
 
+// Vehicle state published once per cycle, see stabilizerGetState()
+static seqlock_t stateLock;
+static vehicleState_t stateCopy[2];
+
 static bool isInit;
 
 
 static void stabilizerAltHoldUpdate(void);
+static bool stabilizerIdleUpdate(bool runEstimate);
+static void stabilizerDeadlineUpdate(uint32_t lateTicks);
+static uint16_t stabilizerDeadlineLandThrust(uint16_t thrust);
+static void stabilizerRangeFusionUpdate(void);
+static void stabilizerPublishState(uint32_t tick);
+static void stabilizerPositionUpdate(float dt);
 static void stabilizerRotateYaw(float yawRad);
 static void stabilizerRotateYawCarefree(bool reset);
 static void stabilizerYawModeUpdate(void);
+static void stabilizerAutotuneAttitude(void);
+static void stabilizerAutotuneRate(void);
 static void distributePower(const uint16_t thrust, const int16_t roll,
                             const int16_t pitch, const int16_t yaw);
 static uint16_t limitThrust(int32_t value);
@@ -167,6 +247,9 @@ void stabilizerInit(void)
   imu6Init();
   sensfusion6Init();
   controllerInit();
+  trajectoryInit();
+  blackboxInit();
+  positionControllerInit();
 #if defined(SITAW_ENABLED)
   sitAwInit();
 #endif
@@ -175,6 +258,10 @@ void stabilizerInit(void)
   pitchRateDesired = 0;
   yawRateDesired = 0;
 
+  // Enable the cycle counter used to measure the control path
+  cycleCounterInit();
+  seqlockInit(&stateLock);
+
   xTaskCreate(stabilizerTask, STABILIZER_TASK_NAME,
               STABILIZER_TASK_STACKSIZE, NULL, STABILIZER_TASK_PRI, NULL);
 
@@ -189,6 +276,9 @@ bool stabilizerTest(void)
   pass &= imu6Test();
   pass &= sensfusion6Test();
   pass &= controllerTest();
+  pass &= trajectoryTest();
+  pass &= blackboxTest();
+  pass &= positionControllerTest();
 
   return pass;
 }
@@ -238,6 +328,10 @@ static void stabilizerTask(void* param)
   RPYType yawType;
   uint32_t attitudeCounter = 0;
   uint32_t altHoldCounter = 0;
+  uint32_t positionCounter = 0;
+  uint32_t zeroThrustCounter = 0;
+  uint32_t idleCounter = 0;
+  uint32_t cycleStart;
   uint32_t lastWakeTime;
   float yawRateAngle = 0;
 
@@ -252,8 +346,44 @@ static void stabilizerTask(void* param)
   {
     vTaskDelayUntil(&lastWakeTime, F2T(IMU_UPDATE_FREQ)); // 500Hz
 
+    // vTaskDelayUntil returns immediately when the cycle was already due,
+    // any ticks past the wake time means the deadline was missed.
+    stabilizerDeadlineUpdate(xTaskGetTickCount() - lastWakeTime);
+
+    // While idle only the attitude estimate is kept running, at the idle
+    // rate. The commander is still checked every cycle so that the full rate
+    // cycle is run right away when a setpoint arrives.
+    if (isIdle)
+    {
+      bool runEstimate = (++idleCounter >= IDLE_UPDATE_RATE_DIVIDER);
+
+      isIdle = stabilizerIdleUpdate(runEstimate);
+      if (isIdle)
+      {
+        if (runEstimate)
+        {
+          idleCounter = 0;
+          stabilizerPublishState(lastWakeTime);
+          blackboxRecord(lastWakeTime, &acc);
+        }
+        logSchedulerTick(lastWakeTime);
+        continue;
+      }
+      zeroThrustCounter = 0;
+    }
+
     // Magnetometer not yet used more then for logging.
-    imu9Read(&gyro, &acc, &mag);
+    if (degradeLevel < degradeSkipOptional)
+    {
+      imu9Read(&gyro, &acc, &mag);
+    }
+    else
+    {
+      imu6Read(&gyro, &acc);
+    }
+
+    // Sample the onboard trajectory, if one has been started
+    trajectoryActive = trajectoryEvaluate(lastWakeTime, &trajectorySetpoint);
 
     if (imu6IsCalibrated())
     {
@@ -271,11 +401,35 @@ static void stabilizerTask(void* param)
         eulerYawDesired = -yawRateAngle;
       }
 
+      // Position control runs at a fraction of the loop rate and overrides
+      // the roll and pitch setpoints while it is active
+      if (++positionCounter >= positionControllerGetRateDivider())
+      {
+        stabilizerPositionUpdate(positionCounter / (float)IMU_UPDATE_FREQ);
+        positionCounter = 0;
+      }
+      if (positionActive)
+      {
+        eulerRollDesired = positionRollDesired;
+        eulerPitchDesired = positionPitchDesired;
+        rollType = ANGLE;
+        pitchType = ANGLE;
+      }
+
+      // Start, or abort, a requested autotune run. The relay stands in for
+      // the PIDs, and it is optional work that a late loop skips.
+      autotuneCheckSafety(eulerRollActual, eulerPitchActual, gyro.x, gyro.y, gyro.z,
+                          actuatorThrust,
+                          controllerGetType() == CONTROLLER_PID &&
+                          degradeLevel < degradeSkipOptional);
+
       // 250HZ
       if (++attitudeCounter >= ATTITUDE_UPDATE_RATE_DIVIDER)
       {
+        cycleStart = cycleCounterGet();
         sensfusion6UpdateQ(gyro.x, gyro.y, gyro.z, acc.x, acc.y, acc.z, FUSION_UPDATE_DT);
         sensfusion6GetEulerRPY(&eulerRollActual, &eulerPitchActual, &eulerYawActual);
+        fusionCycles = cycleCounterGet() - cycleStart;
 
         accWZ = sensfusion6GetAccZWithoutGravity(acc.x, acc.y, acc.z);
         accMAG = (acc.x*acc.x) + (acc.y*acc.y) + (acc.z*acc.z);
@@ -285,9 +439,19 @@ static void stabilizerTask(void* param)
         // Adjust yaw if configured to do so
         stabilizerYawModeUpdate();
 
+        if (degradeLevel < degradeSkipOptional)
+        {
+          controllerScheduleGains(actuatorThrust);
+        }
+        cycleStart = cycleCounterGet();
+        // Axes in rate mode have no attitude setpoint, hold the error at zero
         controllerCorrectAttitudePID(eulerRollActual, eulerPitchActual, eulerYawActual,
-                                     eulerRollDesired, eulerPitchDesired, -eulerYawDesired,
+                                     (rollType == RATE) ? eulerRollActual : eulerRollDesired,
+                                     (pitchType == RATE) ? eulerPitchActual : eulerPitchDesired,
+                                     -eulerYawDesired,
                                      &rollRateDesired, &pitchRateDesired, &yawRateDesired);
+        attitudeCycles = cycleCounterGet() - cycleStart;
+        stabilizerAutotuneAttitude();
         attitudeCounter = 0;
 
         /* Call out after performing attitude updates, if any functions would like to use the calculated values. */
@@ -311,10 +475,13 @@ static void stabilizerTask(void* param)
       }
 
       // TODO: Investigate possibility to subtract gyro drift.
+      cycleStart = cycleCounterGet();
       controllerCorrectRatePID(gyro.x, -gyro.y, gyro.z,
                                rollRateDesired, pitchRateDesired, yawRateDesired);
+      rateCycles = cycleCounterGet() - cycleStart;
 
       controllerGetActuatorOutput(&actuatorRoll, &actuatorPitch, &actuatorYaw);
+      stabilizerAutotuneRate();
 
       if (!altHold || !imuHasBarometer())
       {
@@ -327,11 +494,23 @@ static void stabilizerTask(void* param)
         commanderAdvancedWatchdog();
       }
 
+      // Thrust is only taken over while the pilot has not cut it
+      if (positionActive && actuatorThrust > 0)
+      {
+        actuatorThrust = positionThrust;
+      }
+
       /* Call out before performing thrust updates, if any functions would like to influence the thrust. */
       stabilizerPreThrustUpdateCallOut();
 
+      if (degradeLevel == degradeLand)
+      {
+        actuatorThrust = stabilizerDeadlineLandThrust(actuatorThrust);
+      }
+
       if (actuatorThrust > 0)
       {
+        zeroThrustCounter = 0;
 #if defined(TUNE_ROLL)
         distributePower(actuatorThrust, actuatorRoll, 0, 0);
 #elif defined(TUNE_PITCH)
@@ -346,14 +525,72 @@ static void stabilizerTask(void* param)
       {
         distributePower(0, 0, 0, 0);
         controllerResetAllPID();
+        // A newly selected controller only takes over while landed
+        controllerUpdateSelection();
+        positionControllerReset();
 
         // Reset the calculated YAW angle for rate control
         yawRateAngle = eulerYawActual;
+
+        // Drop to the idle rate when landed for a while
+        if (idleEnable && !altHold && !trajectoryIsRunning() && degradeLevel != degradeLand &&
+            (++zeroThrustCounter >= (uint32_t)idleDelay * IMU_UPDATE_FREQ / 1000))
+        {
+          imuSetLowPower(true);
+          isIdle = true;
+          idleCounter = 0;
+        }
       }
     }
+
+    stabilizerPublishState(lastWakeTime);
+    logSchedulerTick(lastWakeTime);
+    blackboxRecord(lastWakeTime, &acc);
   }
 }
 
+static void stabilizerFillState(vehicleState_t* state, uint32_t tick)
+{
+  state->timestamp = tick;
+  state->roll = eulerRollActual;
+  state->pitch = eulerPitchActual;
+  state->yaw = eulerYawActual;
+  state->rollRate = gyro.x;
+  state->pitchRate = gyro.y;
+  state->yawRate = gyro.z;
+  state->accX = acc.x;
+  state->accY = acc.y;
+  state->accZ = acc.z;
+  state->accZWorld = accWZ;
+  state->asl = asl;
+  state->altitude = altEstimate;
+  state->thrust = actuatorThrust;
+  state->motors[0] = motorPowerM1;
+  state->motors[1] = motorPowerM2;
+  state->motors[2] = motorPowerM3;
+  state->motors[3] = motorPowerM4;
+}
+
+static void stabilizerPublishState(uint32_t tick)
+{
+  // Readers use the other copy while one is written
+  seqlockWriteBegin(&stateLock);
+  stabilizerFillState(&stateCopy[0], tick);
+  seqlockWriteSwitch(&stateLock);
+  stabilizerFillState(&stateCopy[1], tick);
+}
+
+void stabilizerGetState(vehicleState_t* state)
+{
+  uint32_t sequence;
+
+  do
+  {
+    sequence = seqlockReadBegin(&stateLock);
+    *state = stateCopy[seqlockReadIndex(sequence)];
+  } while (seqlockReadRetry(&stateLock, sequence));
+}
+
 static void stabilizerPreAltHoldComputeThrustCallOut(void)
 {
   /* Code that shall run BEFORE each altHold thrust computation, should be placed here. */
@@ -403,6 +640,234 @@ static void stabilizerPreAltHoldComputeThrustCallOut(void)
 #endif
 }
 
+static void stabilizerSetDegradeLevel(DegradeLevel level)
+{
+  if (level == degradeLevel)
+    return;
+
+  if (level >= degradeSkipOptional)
+  {
+    autotuneAbort();
+  }
+  logSetRateDivider(level >= degradeLowerLogRate ? deadlineLogDivider : 1);
+  if (level == degradeLand)
+  {
+    landThrust = actuatorThrust;
+  }
+
+  degradeLevel = level;
+  degradeEvents++;
+}
+
+/**
+ * Track missed deadlines. Steps the degradation up one level for each
+ * window with at least deadlineMissThreshold misses, and back down for each
+ * window without misses. Landing is only left once landed.
+ *
+ * @param lateTicks Ticks between the wake time and the actual start of the cycle.
+ */
+static void stabilizerDeadlineUpdate(uint32_t lateTicks)
+{
+  if (lateTicks > 0)
+  {
+    deadlineMisses++;
+    deadlineWindowMisses++;
+    deadlineWorst = max(deadlineWorst, min(lateTicks, UINT16_MAX));
+  }
+
+  if (++deadlineWindowCycles >= DEADLINE_WINDOW_CYCLES)
+  {
+    if (deadlineWindowMisses >= deadlineMissThreshold && degradeLevel < degradeLand)
+    {
+      stabilizerSetDegradeLevel(degradeLevel + 1);
+    }
+    else if (deadlineWindowMisses == 0 && degradeLevel > degradeNone && degradeLevel < degradeLand)
+    {
+      stabilizerSetDegradeLevel(degradeLevel - 1);
+    }
+    deadlineWindowMisses = 0;
+    deadlineWindowCycles = 0;
+  }
+}
+
+/**
+ * Limit the thrust to a ramp down to zero. Normal operation is resumed once
+ * the ramp has ended and the commanded thrust is zero.
+ */
+static uint16_t stabilizerDeadlineLandThrust(uint16_t thrust)
+{
+  landThrust = max(landThrust - deadlineLandRate / IMU_UPDATE_FREQ, 0.0f);
+
+  if (landThrust == 0 && thrust == 0)
+  {
+    stabilizerSetDegradeLevel(degradeNone);
+  }
+
+  return min(thrust, (uint16_t)landThrust);
+}
+
+/**
+ * Run one cycle while idle, with magnetometer and barometer powered down.
+ * Checks if the idle state should be left and, at the idle rate, reads the
+ * accelerometer and gyro to keep the attitude estimate running.
+ *
+ * @param runEstimate true on the cycles the attitude estimate is updated.
+ * @return false if the idle state should be left, then the sensors are
+ *         powered up again.
+ */
+static bool stabilizerIdleUpdate(bool runEstimate)
+{
+  if (runEstimate)
+  {
+    imu6Read(&gyro, &acc);
+    sensfusion6UpdateQ(gyro.x, gyro.y, gyro.z, acc.x, acc.y, acc.z, IDLE_UPDATE_DT);
+    sensfusion6GetEulerRPY(&eulerRollActual, &eulerPitchActual, &eulerYawActual);
+  }
+
+  commanderAdvancedGetThrust(&actuatorThrust);
+
+  if (!idleEnable || actuatorThrust > 0 || commanderAdvancedGetAltHoldMode() ||
+      trajectoryIsRunning())
+  {
+    imuSetLowPower(false);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Replace the attitude PID output of the axis being autotuned with the relay.
+ */
+static void stabilizerAutotuneAttitude(void)
+{
+  float yawError;
+
+  switch (autotuneGetAxis(AUTOTUNE_LOOP_ATTITUDE))
+  {
+    case AUTOTUNE_AXIS_ROLL:
+      rollRateDesired = autotuneRun(eulerRollDesired - eulerRollActual, FUSION_UPDATE_DT);
+      break;
+    case AUTOTUNE_AXIS_PITCH:
+      pitchRateDesired = autotuneRun(eulerPitchDesired - eulerPitchActual, FUSION_UPDATE_DT);
+      break;
+    case AUTOTUNE_AXIS_YAW:
+      yawError = -eulerYawDesired - eulerYawActual;
+      if (yawError > 180.0f)
+        yawError -= 360.0f;
+      else if (yawError < -180.0f)
+        yawError += 360.0f;
+      yawRateDesired = autotuneRun(yawError, FUSION_UPDATE_DT);
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * Replace the rate PID output of the axis being autotuned with the relay.
+ */
+static void stabilizerAutotuneRate(void)
+{
+  switch (autotuneGetAxis(AUTOTUNE_LOOP_RATE))
+  {
+    case AUTOTUNE_AXIS_ROLL:
+      actuatorRoll = (int16_t)autotuneRun(rollRateDesired - gyro.x, IMU_UPDATE_DT);
+      break;
+    case AUTOTUNE_AXIS_PITCH:
+      actuatorPitch = (int16_t)autotuneRun(pitchRateDesired + gyro.y, IMU_UPDATE_DT);
+      break;
+    case AUTOTUNE_AXIS_YAW:
+      actuatorYaw = (int16_t)autotuneRun(yawRateDesired - gyro.z, IMU_UPDATE_DT);
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * Fuse the proximity range with the barometer into altEstimate.
+ *
+ * The range is tilt compensated with the current attitude. While it is valid
+ * the barometer is tracked into the range frame through rangeOffset, and the
+ * estimate is blended towards the range so that altitude hold follows the
+ * ground. When the range becomes invalid the offset is frozen and the
+ * estimate is blended back to the barometer from the last valid range.
+ *
+ * The first valid range after running on the barometer alone moves the
+ * estimate into the range frame at once. The altitude hold target is moved
+ * by the same amount so that the altitude error has no step.
+ */
+static void stabilizerRangeFusionUpdate(void)
+{
+  bool rangeValid = false;
+  float blendStep = ALTHOLD_UPDATE_DT / rangeBlendTime;
+  float shift;
+
+#if defined(PROXIMITY_ENABLED)
+  float range = proximityGetDistanceMedian() / 1000.0f;
+  float tilt = cosf(eulerRollActual * (float)M_PI / 180.0f) *
+               cosf(eulerPitchActual * (float)M_PI / 180.0f);
+
+  rangeValid = (range >= rangeMin) && (range <= rangeMax) && (tilt >= rangeMaxTilt);
+  if (rangeValid)
+  {
+    rangeHeight = range * tilt;
+  }
+#endif
+
+  if (rangeValid && rangeWeight == 0.0f)
+  {
+    shift = (rangeHeight - asl) - rangeOffset;
+    rangeOffset += shift;
+    altHoldTarget += shift;
+#if defined(SITAW_ENABLED)
+    autoTOAltBase += shift;
+#endif
+  }
+
+  if (rangeValid)
+  {
+    rangeOffset = rangeOffset * rangeOffsetAlpha + (rangeHeight - asl) * (1 - rangeOffsetAlpha);
+    rangeWeight = min(rangeWeight + blendStep, 1.0f);
+  }
+  else
+  {
+    rangeWeight = max(rangeWeight - blendStep, 0.0f);
+  }
+
+  altEstimate = rangeWeight * rangeHeight + (1 - rangeWeight) * (asl + rangeOffset);
+}
+
+static void stabilizerPositionUpdate(float dt)
+{
+  positionEstimate_t estimate;
+  trajectoryPoint_t setpoint;
+
+  positionActive = false;
+
+  if (!positionControllerIsEnabled() || !commanderAdvancedGetPositionEstimate(&estimate))
+  {
+    positionControllerReset();
+    return;
+  }
+
+  // An onboard trajectory takes precedence over the setpoint from the ground
+  if (trajectoryActive)
+  {
+    setpoint = trajectorySetpoint;
+  }
+  else if (!commanderAdvancedGetPositionSetpoint(&setpoint))
+  {
+    positionControllerReset();
+    return;
+  }
+
+  positionControllerUpdate(&estimate, &setpoint, eulerYawActual, dt,
+                           &positionRollDesired, &positionPitchDesired, &positionThrust);
+  positionActive = true;
+}
+
 static void stabilizerAltHoldUpdate(void)
 {
   // Get altitude hold commands from pilot
@@ -421,6 +886,9 @@ static void stabilizerAltHoldUpdate(void)
   asl = asl * aslAlpha + aslRaw * (1 - aslAlpha);
   aslLong = aslLong * aslAlphaLong + aslRaw * (1 - aslAlphaLong);
 
+  // Fuse in the proximity range when valid, gives altEstimate
+  stabilizerRangeFusionUpdate();
+
   // Estimate vertical speed based on successive barometer readings. This is ugly :)
   vSpeedASL = deadband(asl - aslLong, vSpeedASLDeadband);
 
@@ -439,13 +907,13 @@ static void stabilizerAltHoldUpdate(void)
   if (setAltHold)
   {
     // Set to current altitude
-    altHoldTarget = asl;
+    altHoldTarget = altEstimate;
 
     // Cache last integral term for reuse after pid init
     const float pre_integral = altHoldPID.integ;
 
     // Reset PID controller
-    pidInit(&altHoldPID, asl, altHoldKp, altHoldKi, altHoldKd,
+    pidInit(&altHoldPID, altEstimate, altHoldKp, altHoldKi, altHoldKd,
             ALTHOLD_UPDATE_DT);
     // TODO set low and high limits depending on voltage
     // TODO for now just use previous I value and manually set limits for whole voltage range
@@ -455,7 +923,7 @@ static void stabilizerAltHoldUpdate(void)
     altHoldPID.integ = pre_integral;
 
     // Reset altHoldPID
-    altHoldPIDVal = pidUpdate(&altHoldPID, asl, false);
+    altHoldPIDVal = pidUpdate(&altHoldPID, altEstimate, false);
   }
 
   /* Call out before performing altHold thrust regulation. */
@@ -469,7 +937,7 @@ static void stabilizerAltHoldUpdate(void)
     pidSetDesired(&altHoldPID, altHoldTarget);
 
     // Compute error (current - target), limit the error
-    altHoldErr = constrain(deadband(asl - altHoldTarget, errDeadband),
+    altHoldErr = constrain(deadband(altEstimate - altHoldTarget, errDeadband),
                            -altHoldErrMax, altHoldErrMax);
     pidSetError(&altHoldPID, -altHoldErr);
 
@@ -477,7 +945,7 @@ static void stabilizerAltHoldUpdate(void)
     // Smooth it and include barometer vspeed
     // TODO same as smoothing the error??
     altHoldPIDVal = (pidAlpha) * altHoldPIDVal + (1.f - pidAlpha) * ((vSpeedAcc * vSpeedAccFac) +
-                    (vSpeedASL * vSpeedASLFac) + pidUpdate(&altHoldPID, asl, false));
+                    (vSpeedASL * vSpeedASLFac) + pidUpdate(&altHoldPID, altEstimate, false));
 
     // compute new thrust
     actuatorThrust =  max(altHoldMinThrust, min(altHoldMaxThrust,
@@ -577,6 +1045,8 @@ static void stabilizerYawModeUpdate(void)
 static void distributePower(const uint16_t thrust, const int16_t roll,
                             const int16_t pitch, const int16_t yaw)
 {
+  uint32_t batCompensation;
+
 #ifdef QUAD_FORMATION_X
   int16_t r = roll >> 1;
   int16_t p = pitch >> 1;
@@ -591,10 +1061,17 @@ static void distributePower(const uint16_t thrust, const int16_t roll,
   motorPowerM4 =  limitThrust(thrust + roll - yaw);
 #endif
 
-  motorsSetRatio(MOTOR_M1, motorPowerM1);
-  motorsSetRatio(MOTOR_M2, motorPowerM2);
-  motorsSetRatio(MOTOR_M3, motorPowerM3);
-  motorsSetRatio(MOTOR_M4, motorPowerM4);
+  // Battery compensation is computed once and applied to all motors
+  batCompensation = motorsGetBatteryCompensation(pmGetBatteryVoltage());
+
+  motorsBeginUpdate();
+  motorsSetThrust(MOTOR_M1, motorPowerM1, batCompensation);
+  motorsSetThrust(MOTOR_M2, motorPowerM2, batCompensation);
+  motorsSetThrust(MOTOR_M3, motorPowerM3, batCompensation);
+  motorsSetThrust(MOTOR_M4, motorPowerM4, batCompensation);
+  motorsCommitUpdate();
+
+  latencyMotorsUpdated();
 }
 
 static uint16_t limitThrust(int32_t value)
@@ -640,6 +1117,7 @@ LOG_ADD(LOG_FLOAT, roll, &eulerRollActual)
 LOG_ADD(LOG_FLOAT, pitch, &eulerPitchActual)
 LOG_ADD(LOG_FLOAT, yaw, &eulerYawActual)
 LOG_ADD(LOG_UINT16, thrust, &actuatorThrust)
+LOG_ADD(LOG_UINT8, idle, &isIdle)
 LOG_GROUP_STOP(stabilizer)
 
 LOG_GROUP_START(acc)
@@ -692,6 +1170,9 @@ LOG_ADD(LOG_FLOAT, zSpeed, &vSpeed)
 LOG_ADD(LOG_FLOAT, vSpeed, &vSpeed)
 LOG_ADD(LOG_FLOAT, vSpeedASL, &vSpeedASL)
 LOG_ADD(LOG_FLOAT, vSpeedAcc, &vSpeedAcc)
+LOG_ADD(LOG_FLOAT, alt, &altEstimate)
+LOG_ADD(LOG_FLOAT, range, &rangeHeight)
+LOG_ADD(LOG_FLOAT, rangeW, &rangeWeight)
 LOG_GROUP_STOP(altHold)
 
 #if defined(SITAW_ENABLED)
@@ -703,6 +1184,31 @@ LOG_ADD(LOG_FLOAT, AltCurrent, &autoTOAltCurrent)
 LOG_GROUP_STOP(autoTO)
 #endif
 
+LOG_GROUP_START(cycles)
+LOG_ADD(LOG_UINT32, fusion, &fusionCycles)
+LOG_ADD(LOG_UINT32, attitude, &attitudeCycles)
+LOG_ADD(LOG_UINT32, rate, &rateCycles)
+LOG_GROUP_STOP(cycles)
+
+LOG_GROUP_START(deadline)
+LOG_ADD(LOG_UINT32, misses, &deadlineMisses)
+LOG_ADD(LOG_UINT16, worst, &deadlineWorst)
+LOG_ADD(LOG_UINT8, level, &degradeLevel)
+LOG_ADD(LOG_UINT32, events, &degradeEvents)
+LOG_GROUP_STOP(deadline)
+
+PARAM_GROUP_START(deadline)
+PARAM_ADD(PARAM_UINT16, missThresh, &deadlineMissThreshold)
+PARAM_ADD(PARAM_UINT8, logDivider, &deadlineLogDivider)
+PARAM_ADD(PARAM_FLOAT, landRate, &deadlineLandRate)
+PARAM_GROUP_STOP(deadline)
+
+// Params for the idle state
+PARAM_GROUP_START(stabilizer)
+PARAM_ADD(PARAM_UINT8, idleEnable, &idleEnable)
+PARAM_ADD(PARAM_UINT16, idleDelay, &idleDelay)
+PARAM_GROUP_STOP(stabilizer)
+
 // Params for altitude hold
 PARAM_GROUP_START(altHold)
 PARAM_ADD(PARAM_FLOAT, aslAlpha, &aslAlpha)
@@ -725,6 +1231,11 @@ PARAM_ADD(PARAM_FLOAT, vSpeedLimit, &vSpeedLimit)
 PARAM_ADD(PARAM_UINT16, baseThrust, &altHoldBaseThrust)
 PARAM_ADD(PARAM_UINT16, maxThrust, &altHoldMaxThrust)
 PARAM_ADD(PARAM_UINT16, minThrust, &altHoldMinThrust)
+PARAM_ADD(PARAM_FLOAT, rangeMin, &rangeMin)
+PARAM_ADD(PARAM_FLOAT, rangeMax, &rangeMax)
+PARAM_ADD(PARAM_FLOAT, rangeMaxTilt, &rangeMaxTilt)
+PARAM_ADD(PARAM_FLOAT, rangeOffAlpha, &rangeOffsetAlpha)
+PARAM_ADD(PARAM_FLOAT, rangeBlendTime, &rangeBlendTime)
 PARAM_GROUP_STOP(altHold)
 
 #if defined(SITAW_ENABLED)
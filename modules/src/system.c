@@ -57,6 +57,7 @@
 #include "proximity.h"
 #include "watchdog.h"
 #include "queuemonitor.h"
+#include "usec_time.h"
 #include "buzzer.h"
 #include "sound.h"
 
@@ -97,6 +98,9 @@ void systemInit(void)
   usblinkInit();
 #endif
 
+  // Used for the latency stamps from the first received packet on
+  initUsecTimer();
+
   /* Initialized hear and early so that DEBUG_PRINT (buffered) can be used early */
   crtpInit();
   consoleInit();
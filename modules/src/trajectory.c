@@ -0,0 +1,247 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * trajectory.c - Onboard piecewise polynomial trajectories.
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "crtp.h"
+#include "log.h"
+#include "trajectory.h"
+
+#define TRAJECTORY_CH     0
+
+#define CMD_START         0
+#define CMD_STOP          1
+
+#define TRAJECTORY_MAX_PIECES (TRAJECTORY_MEM_SIZE / sizeof(trajectoryPoly4d_t))
+
+typedef enum {
+  trajectoryIdle     = 0,
+  trajectoryWaiting  = 1, /* Start command received, waiting for the start time. */
+  trajectoryRunning  = 2,
+  trajectoryFinished = 3, /* Holding the last point. */
+} trajectoryState_t;
+
+struct trajectoryCrtpStart {
+  uint8_t command;
+  uint8_t startPiece;
+  uint8_t nPieces;
+  uint16_t delayMs;
+} __attribute__((packed));
+
+static bool isInit;
+
+/* Uploaded trajectory, accessed as an array of pieces. */
+static union {
+  uint8_t raw[TRAJECTORY_MEM_SIZE];
+  trajectoryPoly4d_t pieces[TRAJECTORY_MAX_PIECES];
+} trajectoryMem;
+
+static volatile uint8_t state = trajectoryIdle;
+static uint32_t startTick;
+static uint8_t firstPiece;
+static uint8_t lastPiece;
+
+/* Evaluation state, only touched from trajectoryEvaluate(). */
+static uint8_t currentPiece;
+static float currentPieceStart;
+static trajectoryPoint_t lastPoint;
+
+static void trajectoryCrtpCB(CRTPPacket* pk);
+
+void trajectoryInit(void)
+{
+  if(isInit)
+    return;
+
+  crtpInit();
+  crtpRegisterPortCB(CRTP_PORT_TRAJECTORY, trajectoryCrtpCB);
+
+  isInit = true;
+}
+
+bool trajectoryTest(void)
+{
+  return isInit;
+}
+
+/* Called from the CRTP RX task, only updates the state. */
+static void trajectoryCrtpCB(CRTPPacket* pk)
+{
+  struct trajectoryCrtpStart* start = (struct trajectoryCrtpStart*)pk->data;
+
+  if (pk->channel != TRAJECTORY_CH || pk->size < 1)
+    return;
+
+  switch (pk->data[0])
+  {
+    case CMD_START:
+      if (pk->size >= sizeof(struct trajectoryCrtpStart))
+        trajectoryStart(start->startPiece, start->nPieces, start->delayMs);
+      break;
+    case CMD_STOP:
+      trajectoryStop();
+      break;
+    default:
+      break;
+  }
+}
+
+int trajectoryStart(uint8_t startPiece, uint8_t nPieces, uint16_t delayMs)
+{
+  if (nPieces == 0 || startPiece + nPieces > TRAJECTORY_MAX_PIECES)
+    return EINVAL;
+
+  state = trajectoryIdle;
+  firstPiece = startPiece;
+  lastPiece = startPiece + nPieces - 1;
+  startTick = xTaskGetTickCount() + M2T(delayMs);
+  state = trajectoryWaiting;
+
+  return 0;
+}
+
+void trajectoryStop(void)
+{
+  state = trajectoryIdle;
+}
+
+bool trajectoryIsRunning(void)
+{
+  return (state != trajectoryIdle);
+}
+
+/* Evaluate a polynomial and its derivative with Horner's method. */
+static float polyEval(const float* p, float t, float* deriv)
+{
+  float value = p[TRAJECTORY_POLY_COEFFS - 1];
+  float d = 0;
+  int i;
+
+  for (i = TRAJECTORY_POLY_COEFFS - 2; i >= 0; i--)
+  {
+    d = d * t + value;
+    value = value * t + p[i];
+  }
+  *deriv = d;
+
+  return value;
+}
+
+static void pieceEval(const trajectoryPoly4d_t* piece, float t, trajectoryPoint_t *point)
+{
+  float yawRate;
+
+  point->x = polyEval(piece->p[TRAJECTORY_X], t, &point->vx);
+  point->y = polyEval(piece->p[TRAJECTORY_Y], t, &point->vy);
+  point->z = polyEval(piece->p[TRAJECTORY_Z], t, &point->vz);
+  point->yaw = polyEval(piece->p[TRAJECTORY_YAW], t, &yawRate);
+}
+
+bool trajectoryEvaluate(uint32_t tick, trajectoryPoint_t *point)
+{
+  const trajectoryPoly4d_t* piece;
+  float t;
+
+  switch (state)
+  {
+    case trajectoryWaiting:
+      if ((int32_t)(tick - startTick) < 0)
+        return false;
+      currentPiece = firstPiece;
+      currentPieceStart = 0;
+      state = trajectoryRunning;
+      // Fall through
+    case trajectoryRunning:
+      t = (float)(tick - startTick) / configTICK_RATE_HZ;
+      piece = &trajectoryMem.pieces[currentPiece];
+
+      // Advance to the piece covering t. Normally at most one step per call.
+      while (t - currentPieceStart > piece->duration)
+      {
+        if (currentPiece >= lastPiece)
+        {
+          pieceEval(piece, piece->duration, &lastPoint);
+          lastPoint.vx = lastPoint.vy = lastPoint.vz = 0;
+          state = trajectoryFinished;
+          *point = lastPoint;
+          return true;
+        }
+        currentPieceStart += piece->duration;
+        piece = &trajectoryMem.pieces[++currentPiece];
+      }
+
+      pieceEval(piece, t - currentPieceStart, &lastPoint);
+      *point = lastPoint;
+      return true;
+    case trajectoryFinished:
+      *point = lastPoint;
+      return true;
+    case trajectoryIdle: // Fall through
+    default:
+      return false;
+  }
+}
+
+uint32_t trajectoryMemGetSize(void)
+{
+  return sizeof(trajectoryMem);
+}
+
+bool trajectoryMemRead(uint32_t memAddr, uint8_t readLen, uint8_t *buffer)
+{
+  // Written so that a large address can not wrap past the check
+  if (memAddr > sizeof(trajectoryMem) || readLen > sizeof(trajectoryMem) - memAddr)
+    return false;
+
+  memcpy(buffer, &trajectoryMem.raw[memAddr], readLen);
+
+  return true;
+}
+
+bool trajectoryMemWrite(uint32_t memAddr, uint8_t writeLen, const uint8_t *buffer)
+{
+  // The memory can not be changed while a trajectory is being flown
+  if (memAddr > sizeof(trajectoryMem) || writeLen > sizeof(trajectoryMem) - memAddr ||
+      trajectoryIsRunning())
+    return false;
+
+  memcpy(&trajectoryMem.raw[memAddr], buffer, writeLen);
+
+  return true;
+}
+
+LOG_GROUP_START(traj)
+LOG_ADD(LOG_UINT8, state, &state)
+LOG_ADD(LOG_UINT8, piece, &currentPiece)
+LOG_ADD(LOG_FLOAT, x, &lastPoint.x)
+LOG_ADD(LOG_FLOAT, y, &lastPoint.y)
+LOG_ADD(LOG_FLOAT, z, &lastPoint.z)
+LOG_ADD(LOG_FLOAT, yaw, &lastPoint.yaw)
+LOG_GROUP_STOP(traj)
@@ -0,0 +1,23 @@
+/*
+ * Host replacement of hal/interface/cyclecounter.h for the SITL build.
+ * Counts nanoseconds instead of CPU cycles.
+ */
+#ifndef CYCLECOUNTER_H_
+#define CYCLECOUNTER_H_
+
+#include <stdint.h>
+#include <time.h>
+
+static inline void cycleCounterInit(void)
+{
+}
+
+static inline uint32_t cycleCounterGet(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+#endif /* CYCLECOUNTER_H_ */
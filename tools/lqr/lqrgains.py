@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+# Computes the gain matrix of the LQR attitude controller (lqrcontroller.c)
+# from a parametrised vehicle model and writes it as a C table.
+#
+# The state is [integral of attitude error, attitude error, rate error] per
+# axis (deg*s, deg, deg/s) and the input is the roll/pitch/yaw actuator
+# command that distributePower() mixes to the motors. The model is linearised
+# at hover and discretised at the rate loop period.
+import argparse
+import math
+import sys
+
+header = """/* This file is automatically generated by {0}!
+ * Do not edit manually, any manual change will be overwritten.
+ *
+ * {1}
+ */
+"""
+
+STATES = 9
+INPUTS = 3
+
+
+def zeros(rows, cols):
+    return [[0.0] * cols for _ in range(rows)]
+
+
+def eye(n):
+    m = zeros(n, n)
+    for i in range(n):
+        m[i][i] = 1.0
+    return m
+
+
+def mul(a, b):
+    return [[sum(a[i][k] * b[k][j] for k in range(len(b)))
+             for j in range(len(b[0]))] for i in range(len(a))]
+
+
+def add(a, b):
+    return [[a[i][j] + b[i][j] for j in range(len(a[0]))] for i in range(len(a))]
+
+
+def sub(a, b):
+    return [[a[i][j] - b[i][j] for j in range(len(a[0]))] for i in range(len(a))]
+
+
+def transpose(a):
+    return [list(row) for row in zip(*a)]
+
+
+def inverse(a):
+    n = len(a)
+    m = [list(a[i]) + eye(n)[i] for i in range(n)]
+    for col in range(n):
+        pivot = max(range(col, n), key=lambda r: abs(m[r][col]))
+        if abs(m[pivot][col]) < 1e-300:
+            raise ValueError("Singular matrix")
+        m[col], m[pivot] = m[pivot], m[col]
+        p = m[col][col]
+        m[col] = [v / p for v in m[col]]
+        for r in range(n):
+            if r != col:
+                f = m[r][col]
+                m[r] = [m[r][j] - f * m[col][j] for j in range(2 * n)]
+    return [row[n:] for row in m]
+
+
+def effectiveness(args):
+    """Angular acceleration in deg/s^2 per actuator unit, as a 3x3 matrix."""
+    thrust = args.thrust_per_unit
+    if args.formation == "x":
+        # distributePower() applies roll/2 and pitch/2 to all four motors
+        # at arm/sqrt(2) from the axis
+        arm = args.arm / math.sqrt(2)
+        roll = 4 * 0.5 * thrust * arm
+        pitch = roll
+    else:
+        # Two motors at full arm length per axis
+        roll = 2 * thrust * args.arm
+        pitch = roll
+    yaw = 4 * thrust * args.torque_coeff
+    torque = [[roll, 0, 0], [0, pitch, 0], [0, 0, yaw]]
+
+    inertia = [[args.ixx, -args.ixy, -args.ixz],
+               [-args.ixy, args.iyy, -args.iyz],
+               [-args.ixz, -args.iyz, args.izz]]
+    m = mul(inverse(inertia), torque)
+    return [[v * 180.0 / math.pi for v in row] for row in m]
+
+
+def model(args):
+    dt = 1.0 / args.rate
+    m = effectiveness(args)
+    a = eye(STATES)
+    b = zeros(STATES, INPUTS)
+    for i in range(3):
+        a[i][3 + i] = dt
+        a[i][6 + i] = dt * dt / 2
+        a[3 + i][6 + i] = dt
+        for j in range(3):
+            b[i][j] = dt * dt * dt / 6 * m[i][j]
+            b[3 + i][j] = dt * dt / 2 * m[i][j]
+            b[6 + i][j] = dt * m[i][j]
+    return a, b
+
+
+def dlqr(a, b, q, r, iterations, tolerance):
+    """Solves the discrete Riccati equation by iteration, returns K for u = -K x."""
+    p = q
+    at = transpose(a)
+    bt = transpose(b)
+    for i in range(iterations):
+        btp = mul(bt, p)
+        k = mul(inverse(add(r, mul(btp, b))), mul(btp, a))
+        pn = add(q, mul(mul(at, p), sub(a, mul(b, k))))
+        diff = max(abs(pn[x][y] - p[x][y]) for x in range(STATES) for y in range(STATES))
+        p = pn
+        if diff < tolerance * max(1.0, max(abs(v) for row in p for v in row)):
+            return k, i
+    raise ValueError("Riccati iteration did not converge")
+
+
+def diag(values):
+    m = zeros(len(values), len(values))
+    for i, v in enumerate(values):
+        m[i][i] = v
+    return m
+
+
+def cfloat(value):
+    text = "{0:.6g}".format(value)
+    if "." not in text and "e" not in text:
+        text += ".0"
+    return text + "f"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compute LQR attitude gains")
+    # Measured Crazyflie 2.0 inertia tensor, the off diagonal terms of the
+    # tensor are -ixy, -ixz and -iyz and couple the three axes.
+    parser.add_argument("--ixx", type=float, default=1.657e-5, help="kg m^2")
+    parser.add_argument("--iyy", type=float, default=1.666e-5, help="kg m^2")
+    parser.add_argument("--izz", type=float, default=2.926e-5, help="kg m^2")
+    parser.add_argument("--ixy", type=float, default=-8.308e-7, help="Product of inertia, kg m^2")
+    parser.add_argument("--ixz", type=float, default=-7.183e-7, help="Product of inertia, kg m^2")
+    parser.add_argument("--iyz", type=float, default=-1.800e-6, help="Product of inertia, kg m^2")
+    parser.add_argument("--arm", type=float, default=0.046, help="Motor to center distance, m")
+    parser.add_argument("--thrust-per-unit", type=float, default=2.25e-6,
+                        help="Motor thrust per actuator unit, N")
+    parser.add_argument("--torque-coeff", type=float, default=0.006,
+                        help="Motor drag torque to thrust ratio, m")
+    parser.add_argument("--formation", choices=["x", "plus"], default="x")
+    parser.add_argument("--rate", type=float, default=500.0, help="Rate loop frequency, Hz")
+    parser.add_argument("--q-integ", type=float, nargs=3, default=[100.0, 100.0, 10.0],
+                        help="Integral weights roll pitch yaw")
+    parser.add_argument("--q-angle", type=float, nargs=3, default=[1000.0, 1000.0, 300.0],
+                        help="Attitude weights roll pitch yaw")
+    parser.add_argument("--q-rate", type=float, nargs=3, default=[10.0, 10.0, 10.0],
+                        help="Rate weights roll pitch yaw")
+    parser.add_argument("--r", type=float, nargs=3, default=[3e-3, 3e-3, 3e-3],
+                        help="Input weights roll pitch yaw")
+    parser.add_argument("--output", help="C header to write, default stdout")
+    parser.add_argument("--params", action="store_true",
+                        help="Print the gains as lqr.* param assignments instead")
+    args = parser.parse_args()
+
+    a, b = model(args)
+    dt = 1.0 / args.rate
+    # The weights are per second, scale them to the sample period
+    q = diag([w * dt for w in args.q_integ + args.q_angle + args.q_rate])
+    r = diag([w * dt for w in args.r])
+    k, iterations = dlqr(a, b, q, r, 2000000, 1e-10)
+
+    if args.params:
+        for i in range(INPUTS):
+            for j in range(STATES):
+                print("lqr.k{0}{1} = {2:.6g}".format(i, j, k[i][j]))
+        return
+
+    command = " ".join([sys.argv[0].split("/")[-1]] + sys.argv[1:])
+    out = header.format("tools/lqr/lqrgains.py", command)
+    out += "#ifndef LQRGAINS_H_\n#define LQRGAINS_H_\n\n"
+    out += "/* Converged after {0} iterations. */\n".format(iterations)
+    out += "#define LQR_GAINS { \\\n"
+    for i in range(INPUTS):
+        row = ", ".join(cfloat(v) for v in k[i])
+        out += "  { " + row + " }," + " \\\n"
+    out += "}\n\n#endif /* LQRGAINS_H_ */\n"
+
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(out)
+    else:
+        sys.stdout.write(out)
+
+
+if __name__ == "__main__":
+    main()
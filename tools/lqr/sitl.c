@@ -0,0 +1,325 @@
+/*
+ * Host software-in-the-loop comparison of the attitude controllers.
+ *
+ * Builds the firmware controller.c (PID, INDI and LQR paths) for the host and
+ * closes the loop around a linearised vehicle model with motor lag and gyro
+ * noise. The controllers are called at the same rates as in stabilizer.c.
+ * The model uses the same defaults as lqrgains.py.
+ *
+ * The relay autotuner is then run end to end on the roll rate loop, started
+ * and applied through its params, and the measured ultimate gain and period
+ * are checked against the limit cycle predicted for the model. Exits with 1
+ * if they disagree.
+ *
+ * Usage: make && ./sitl
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "controller.h"
+#include "autotune.h"
+#include "param.h"
+#include "log.h"
+#include "imu.h"
+
+#define SIM_SUBSTEPS      4        // Plant integration steps per rate loop cycle
+#define SIM_TIME          6.0f     // s
+#define STEP_TIME         0.5f     // s, roll attitude step
+#define STEP_SIZE         10.0f    // deg
+#define DISTURBANCE_TIME  3.0f     // s, roll torque step
+#define DISTURBANCE_ACC   150.0f   // deg/s^2
+#define MOTOR_TAU         0.025f   // s
+#define GYRO_NOISE        0.5f     // deg/s, uniform
+
+#define IXX               1.657e-5f
+#define IYY               1.666e-5f
+#define IZZ               2.926e-5f
+#define ARM               0.046f
+#define THRUST_PER_UNIT   2.25e-6f
+#define TORQUE_COEFF      0.006f
+
+#define TUNE_THRUST       30000    // Above autotune.minThrust
+#define TUNE_TIME         5.0f     // s, longest autotune run simulated
+#define TUNE_TOLERANCE    0.3f     // Relative error allowed on Ku and Tu
+
+extern const struct param_s _param_start;
+extern const struct param_s _param_stop;
+extern const struct log_s _log_start;
+extern const struct log_s _log_stop;
+
+typedef struct
+{
+  float riseTime;       // 10-90%, s
+  float overshoot;      // % of the step
+  float settleTime;     // Within 5% of the step, s
+  float disturbPeak;    // Largest deviation after the disturbance, deg
+  float finalError;     // deg
+  float effort;         // RMS roll command
+} Result;
+
+static float noise(void)
+{
+  return GYRO_NOISE * (2.0f * rand() / (float)RAND_MAX - 1.0f);
+}
+
+/**
+ * Look up a param or log variable by group and name the way a client would.
+ * Both tables share the layout of struct param_s. Unlike on the target the
+ * host compiler aligns each group, the zero padding between the groups is
+ * skipped.
+ */
+static void* tocAddress(const void* start, const void* stop, const char* group,
+                        const char* name)
+{
+  const char* p = start;
+  const char* current = NULL;
+  const struct param_s* entry;
+
+  while (p < (const char*)stop)
+  {
+    entry = (const struct param_s*)p;
+
+    if (!current && *(const uintptr_t*)p == 0)
+    {
+      p += sizeof(uintptr_t);
+      continue;
+    }
+
+    if (entry->type & PARAM_GROUP)
+      current = (entry->type & PARAM_START) ? entry->name : NULL;
+    else if (current && !strcmp(current, group) && !strcmp(entry->name, name))
+      return entry->address;
+
+    p += sizeof(*entry);
+  }
+
+  fprintf(stderr, "No %s.%s\n", group, name);
+  exit(1);
+}
+
+static void* paramAddress(const char* group, const char* name)
+{
+  return tocAddress(&_param_start, &_param_stop, group, name);
+}
+
+static void* logAddress(const char* group, const char* name)
+{
+  return tocAddress(&_log_start, &_log_stop, group, name);
+}
+
+static Result simulate(ControllerType type)
+{
+  const float dt = IMU_UPDATE_DT / SIM_SUBSTEPS;
+  const float toDeg = 180.0f / (float)M_PI;
+  // Angular acceleration per actuator unit, X formation
+  const float effRoll = 4 * 0.5f * THRUST_PER_UNIT * ARM / sqrtf(2) / IXX * toDeg;
+  const float effPitch = 4 * 0.5f * THRUST_PER_UNIT * ARM / sqrtf(2) / IYY * toDeg;
+  const float effYaw = 4 * THRUST_PER_UNIT * TORQUE_COEFF / IZZ * toDeg;
+
+  float angle[3] = { 0 }, rate[3] = { 0 }, motor[3] = { 0 };
+  float rateDesired[3] = { 0 };
+  int16_t out[3] = { 0 };
+  float t = 0, effort = 0;
+  float t10 = -1, t90 = -1, lastOutside = 0, peak = 0;
+  int cycle = 0, i, s;
+  Result r = { 0 };
+
+  srand(1);
+  controllerSetType(type);
+  controllerUpdateSelection();
+  controllerResetAllPID();
+
+  while (t < SIM_TIME)
+  {
+    float rollDesired = (t >= STEP_TIME) ? STEP_SIZE : 0;
+    float disturbance = (t >= DISTURBANCE_TIME) ? DISTURBANCE_ACC : 0;
+
+    if ((cycle++ % 2) == 0)
+    {
+      controllerCorrectAttitudePID(angle[0], angle[1], angle[2], rollDesired, 0, 0,
+                                   &rateDesired[0], &rateDesired[1], &rateDesired[2]);
+    }
+    controllerCorrectRatePID(rate[0] + noise(), rate[1] + noise(), rate[2] + noise(),
+                             rateDesired[0], rateDesired[1], rateDesired[2]);
+    controllerGetActuatorOutput(&out[0], &out[1], &out[2]);
+    effort += (float)out[0] * out[0];
+
+    for (s = 0; s < SIM_SUBSTEPS; s++)
+    {
+      for (i = 0; i < 3; i++)
+        motor[i] += (out[i] - motor[i]) * dt / MOTOR_TAU;
+      rate[0] += (effRoll * motor[0] + disturbance) * dt;
+      rate[1] += effPitch * motor[1] * dt;
+      rate[2] += effYaw * motor[2] * dt;
+      for (i = 0; i < 3; i++)
+        angle[i] += rate[i] * dt;
+      t += dt;
+    }
+
+    if (t < DISTURBANCE_TIME)
+    {
+      if (t10 < 0 && angle[0] >= 0.1f * STEP_SIZE)
+        t10 = t;
+      if (t90 < 0 && angle[0] >= 0.9f * STEP_SIZE)
+        t90 = t;
+      if (angle[0] - STEP_SIZE > peak)
+        peak = angle[0] - STEP_SIZE;
+      if (fabsf(angle[0] - rollDesired) > 0.05f * STEP_SIZE)
+        lastOutside = t;
+    }
+    else if (fabsf(angle[0] - STEP_SIZE) > r.disturbPeak)
+    {
+      r.disturbPeak = fabsf(angle[0] - STEP_SIZE);
+    }
+  }
+
+  r.riseTime = (t10 >= 0 && t90 >= 0) ? t90 - t10 : NAN;
+  r.overshoot = 100.0f * peak / STEP_SIZE;
+  r.settleTime = lastOutside - STEP_TIME;
+  r.finalError = angle[0] - STEP_SIZE;
+  r.effort = sqrtf(effort / cycle);
+  return r;
+}
+
+/**
+ * Limit cycle the relay should find on the roll rate loop of the model.
+ * Actuator to rate is effRoll / (s (tau s + 1)), delayed by half a rate
+ * cycle by the zero order hold. A relay of amplitude d and hysteresis h
+ * oscillates with error amplitude a = 4d |G(jw)| / pi where its describing
+ * function, lagging by asin(h / a), brings the loop phase to -180 deg:
+ * atan(w tau) + w T + asin(h / a) = pi / 2.
+ */
+static void relayLimitCycle(float effRoll, float d, float h, float* ku, float* tu)
+{
+  const float delay = IMU_UPDATE_DT / 2;
+  float lo = 0, hi = 1.0f / delay, w = 0, a = 0, lag;
+  int i;
+
+  for (i = 0; i < 60; i++)
+  {
+    w = (lo + hi) / 2;
+    a = 4 * d / (float)M_PI * effRoll / (w * sqrtf(1 + w * MOTOR_TAU * w * MOTOR_TAU));
+    lag = (h < a) ? asinf(h / a) : (float)M_PI / 2;
+    if (atanf(w * MOTOR_TAU) + w * delay + lag < (float)M_PI / 2)
+      lo = w;
+    else
+      hi = w;
+  }
+
+  *ku = 4 * d / ((float)M_PI * a);
+  *tu = 2 * (float)M_PI / w;
+}
+
+/**
+ * Run the autotuner on the roll rate loop while hovering, as the stabilizer
+ * does, and compare its result with the model.
+ *
+ * @return true if Ku and Tu are within TUNE_TOLERANCE of the model, and a
+ * run is refused while another controller is flying.
+ */
+static bool simulateAutotune(void)
+{
+  const float dt = IMU_UPDATE_DT / SIM_SUBSTEPS;
+  const float toDeg = 180.0f / (float)M_PI;
+  const float effRoll = 4 * 0.5f * THRUST_PER_UNIT * ARM / sqrtf(2) / IXX * toDeg;
+  float angle = 0, rate = 0, motor = 0, rateDesired[3] = { 0 };
+  float measuredRate, t = 0, kuModel, tuModel, ku, tu, kp, ki, kd;
+  int16_t out[3] = { 0 };
+  uint8_t state = autotuneIdle;
+  int cycle = 0, s;
+  bool refused;
+
+  // The relay only stands in for the PIDs
+  controllerSetType(CONTROLLER_LQR);
+  controllerUpdateSelection();
+  *(uint8_t*)paramAddress("autotune", "axis") = AUTOTUNE_AXIS_ROLL;
+  *(uint8_t*)paramAddress("autotune", "loop") = AUTOTUNE_LOOP_RATE;
+  *(uint8_t*)paramAddress("autotune", "start") = 1;
+  autotuneCheckSafety(0, 0, 0, 0, 0, TUNE_THRUST, controllerGetType() == CONTROLLER_PID);
+  refused = autotuneGetAxis(AUTOTUNE_LOOP_RATE) == AUTOTUNE_AXIS_NONE;
+
+  srand(1);
+  controllerSetType(CONTROLLER_PID);
+  controllerUpdateSelection();
+  controllerResetAllPID();
+
+  *(uint8_t*)paramAddress("autotune", "axis") = AUTOTUNE_AXIS_ROLL;
+  *(uint8_t*)paramAddress("autotune", "loop") = AUTOTUNE_LOOP_RATE;
+  *(uint8_t*)paramAddress("autotune", "apply") = 1;
+  *(uint8_t*)paramAddress("autotune", "start") = 1;
+
+  while (t < TUNE_TIME)
+  {
+    measuredRate = rate + noise();
+
+    autotuneCheckSafety(angle, 0, measuredRate, 0, 0, TUNE_THRUST,
+                        controllerGetType() == CONTROLLER_PID);
+    if ((cycle++ % 2) == 0)
+    {
+      controllerCorrectAttitudePID(angle, 0, 0, 0, 0, 0,
+                                   &rateDesired[0], &rateDesired[1], &rateDesired[2]);
+    }
+    controllerCorrectRatePID(measuredRate, 0, 0, rateDesired[0], 0, 0);
+    controllerGetActuatorOutput(&out[0], &out[1], &out[2]);
+    if (autotuneGetAxis(AUTOTUNE_LOOP_RATE) == AUTOTUNE_AXIS_ROLL)
+      out[0] = (int16_t)autotuneRun(rateDesired[0] - measuredRate, IMU_UPDATE_DT);
+
+    for (s = 0; s < SIM_SUBSTEPS; s++)
+    {
+      motor += (out[0] - motor) * dt / MOTOR_TAU;
+      rate += effRoll * motor * dt;
+      angle += rate * dt;
+      t += dt;
+    }
+
+    state = *(uint8_t*)logAddress("autotune", "state");
+    if (state != autotuneRunning)
+      break;
+  }
+
+  relayLimitCycle(effRoll, *(float*)paramAddress("autotune", "amp"),
+                  *(float*)paramAddress("autotune", "hyst"), &kuModel, &tuModel);
+  ku = *(float*)logAddress("autotune", "ku");
+  tu = *(float*)logAddress("autotune", "tu");
+  kp = *(float*)paramAddress("autotune", "kp");
+  ki = *(float*)paramAddress("autotune", "ki");
+  kd = *(float*)paramAddress("autotune", "kd");
+
+  printf("\nAutotune roll rate: %s with LQR, state %d after %.2f s\n",
+         refused ? "refused" : "started", state, t);
+  printf("  Ku %8.2f (model %8.2f)  Tu %6.4f s (model %6.4f s)\n", ku, kuModel, tu, tuModel);
+  printf("  Applied kp %.2f ki %.2f kd %.4f, rate roll_kp now %.2f\n", kp, ki, kd,
+         *(float*)paramAddress("pid_rate", "roll_kp"));
+
+  return refused && state == autotuneDone &&
+         fabsf(ku - kuModel) <= TUNE_TOLERANCE * kuModel &&
+         fabsf(tu - tuModel) <= TUNE_TOLERANCE * tuModel &&
+         *(float*)paramAddress("pid_rate", "roll_kp") == kp;
+}
+
+int main(void)
+{
+  static const char* names[] = { "PID", "INDI", "LQR" };
+  int type;
+
+  controllerInit();
+
+  printf("%-5s %10s %10s %10s %12s %12s %10s\n", "", "rise [s]", "overs [%]", "settle [s]",
+         "dist pk [deg]", "final [deg]", "rms cmd");
+  for (type = CONTROLLER_PID; type <= CONTROLLER_LQR; type++)
+  {
+    Result r = simulate(type);
+    printf("%-5s %10.3f %10.1f %10.3f %12.2f %12.3f %10.0f\n", names[type], r.riseTime,
+           r.overshoot, r.settleTime, r.disturbPeak, r.finalError, r.effort);
+  }
+
+  if (!simulateAutotune())
+  {
+    printf("Autotune FAILED\n");
+    return 1;
+  }
+
+  return 0;
+}
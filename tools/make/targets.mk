@@ -50,6 +50,12 @@ $(PROG).dfu: $(PROG).bin
 	@$(if $(QUIET), ,echo $(DFU_COMMAND$(VERBOSE)) )
 	@$(DFU_COMMAND)
 
+TOC_COMMAND=$(PYTHON2) tools/make/tocManifest.py $< $@
+TOC_COMMAND_SILENT="  TOC   $@"
+$(PROG).toc.json: $(PROG).elf
+	@$(if $(QUIET), ,echo $(TOC_COMMAND$(VERBOSE)) )
+	@$(TOC_COMMAND)
+
 AS_COMMAND=$(AS) $(ASFLAGS) $< -o $(BIN)/$@
 AS_COMMAND_SILENT="  AS    $@"
 .s.o:
@@ -62,7 +68,7 @@ clean_o: clean_version
 	@$(if $(QUIET), ,echo $(CLEAN_O_COMMAND$(VERBOSE)) )
 	@$(CLEAN_O_COMMAND)
 
-CLEAN_COMMAND=rm -f cf*.elf cf*.hex cf*.bin cf*.dfu cf*.map $(BIN)/dep/*.d $(BIN)/*.o
+CLEAN_COMMAND=rm -f cf*.elf cf*.hex cf*.bin cf*.dfu cf*.map cf*.toc.json $(BIN)/dep/*.d $(BIN)/*.o
 CLEAN_COMMAND_SILENT="  CLEAN"
 clean:
 	@$(if $(QUIET), ,echo $(CLEAN_COMMAND$(VERBOSE)) )
@@ -0,0 +1,110 @@
+#!/usr/bin/env python
+"""
+Generate the log and param TOC manifest of a firmware image.
+
+The manifest lists every log variable and parameter with its TOC id, type,
+group and name, exactly as the copter reports them over CRTP. Each TOC is
+keyed by the CRC the copter returns with CMD_GET_INFO (logsCrc/paramsCrc),
+computed here over the same linker section, so a client that has the
+manifest for a CRC can skip downloading that TOC.
+
+usage: tocManifest.py cfX.elf cfX.toc.json
+"""
+
+import sys
+import struct
+import json
+import zlib
+
+# TOC ids are one byte on the wire, see log.c and param.c
+TOC_MAX_ITEMS = 256
+GROUP_FLAG = 0x80
+GROUP_START = 0x01
+
+# struct log_s and struct param_s: uint8_t type, char * name, void * address
+ENTRY = struct.Struct('<B3xII')
+
+SHT_SYMTAB = 2
+SHT_NOBITS = 8
+SHF_ALLOC = 0x2
+
+
+class Elf(object):
+    def __init__(self, data):
+        self.data = data
+        if data[:4] != b'\x7fELF' or data[4:5] != b'\x01':
+            raise ValueError('not a 32 bit ELF file')
+
+        (shoff,) = struct.unpack_from('<I', data, 0x20)
+        shentsize, shnum = struct.unpack_from('<HH', data, 0x2E)
+        self.sections = [struct.unpack_from('<IIIIIIIIII', data,
+                                            shoff + i * shentsize)
+                         for i in range(shnum)]
+
+        self.symbols = {}
+        for sh in self.sections:
+            if sh[1] != SHT_SYMTAB:
+                continue
+            strtab = self.sections[sh[6]]
+            for offset in range(sh[4], sh[4] + sh[5], sh[9]):
+                name, value = struct.unpack_from('<II', data, offset)
+                self.symbols[self.cstring(strtab[4] + name)] = value
+
+    def cstring(self, offset):
+        end = self.data.index(b'\0', offset)
+        return self.data[offset:end].decode('ascii')
+
+    def offset(self, address):
+        for sh in self.sections:
+            if (sh[2] & SHF_ALLOC and sh[1] != SHT_NOBITS and
+                    sh[3] <= address < sh[3] + sh[5]):
+                return sh[4] + address - sh[3]
+        raise ValueError('address 0x%08x not in the image' % address)
+
+    def read(self, address, length):
+        start = self.offset(address)
+        return self.data[start:start + length]
+
+    def string(self, address):
+        return self.cstring(self.offset(address))
+
+
+def toc(elf, start, stop):
+    first = elf.symbols[start]
+    raw = elf.read(first, elf.symbols[stop] - first)
+
+    items = []
+    group = None
+    for offset in range(0, len(raw), ENTRY.size):
+        kind, name, _ = ENTRY.unpack_from(raw, offset)
+        if kind & GROUP_FLAG:
+            if kind & GROUP_START:
+                group = elf.string(name)
+        elif len(items) < TOC_MAX_ITEMS:
+            items.append({'id': len(items), 'type': kind,
+                          'group': group, 'name': elf.string(name)})
+
+    return {'crc': '0x%08X' % (zlib.crc32(raw) & 0xFFFFFFFF),
+            'items': items}
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.stderr.write(__doc__)
+        sys.exit(1)
+
+    with open(sys.argv[1], 'rb') as f:
+        elf = Elf(f.read())
+
+    manifest = {
+        'log': toc(elf, '_log_start', '_log_stop'),
+        'param': toc(elf, '_param_start', '_param_stop'),
+    }
+
+    with open(sys.argv[2], 'w') as f:
+        json.dump(manifest, f, indent=2, sort_keys=True)
+        f.write('\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,148 @@
+/*
+ * Host test of the fixed point control path (CONTROL_FIXED_POINT) against
+ * the float one: float to fixed conversion, PidFixObject against PidObject
+ * and the fixed point Mahony filter against the float filter, run side by
+ * side on the same inputs.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pid.h"
+#include "fixmath.h"
+#include "sensfusion6.h"
+
+#define PID_RELATIVE_TOLERANCE  1e-3f
+#define PID_ABSOLUTE_TOLERANCE  0.5f   // Integral truncation adds up, output is int16 scaled
+#define FUSION_TOLERANCE        2e-3f  // Per quaternion component
+#define FUSION_DT               (1.0f / 250)
+#define FUSION_STEPS            5000
+
+/* Fixed point copy of sensfusion6.c, see the Makefile */
+void fix_sensfusion6UpdateQ(float gx, float gy, float gz, float ax, float ay, float az, float dt);
+extern float q0, q1, q2, q3, twoKp, twoKi;
+extern float fix_q0, fix_q1, fix_q2, fix_q3, fix_twoKp, fix_twoKi;
+
+static int failures;
+
+static void check(int ok, const char* what)
+{
+  if (!ok)
+  {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static void testFixFromFloat(void)
+{
+  static const float values[] = { 0.0f, 1.0f, -1.0f, 0.5f, 1e-6f, -1e-6f, 123.456f,
+                                  -2000.0f, 32767.0f, -32767.99f, 3.0e-10f };
+  unsigned int i;
+  int q;
+
+  for (i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+  {
+    for (q = 0; q <= FIX_Q30; q++)
+    {
+      double scaled = (double)values[i] * (double)(1ULL << q);
+      int32_t expected = (scaled >= INT32_MAX) ? INT32_MAX :
+                         (scaled <= -INT32_MAX) ? -INT32_MAX : (int32_t)scaled;
+
+      if (fixFromFloat(values[i], q) != expected)
+      {
+        printf("fixFromFloat(%g, %d) = %d, expected %d\n", values[i], q,
+               fixFromFloat(values[i], q), expected);
+        check(0, "fixFromFloat");
+        return;
+      }
+    }
+  }
+}
+
+static void testPid(float kp, float ki, float kd, float iLimit, float dt, float scale,
+                    const char* name)
+{
+  PidObject pid;
+  PidFixObject pidFix;
+  float out, outFix, worst = 0;
+  int i;
+
+  pidInit(&pid, 0, kp, ki, kd, dt);
+  pidFixInit(&pidFix, 0, kp, ki, kd, dt);
+  pidSetIntegralLimit(&pid, iLimit);
+  pidFixSetIntegralLimit(&pidFix, iLimit);
+
+  for (i = 0; i < 2000; i++)
+  {
+    float t = i * dt;
+    float desired = scale * ((i / 200) % 2 ? 1.0f : -0.5f);
+    float measured = scale * (0.8f * sinf(7 * t) + 0.05f * sinf(130 * t));
+
+    pidSetDesired(&pid, desired);
+    out = pidUpdate(&pid, measured, true);
+    pidFixSetDesired(&pidFix, fixFromFloat(desired, FIX_Q16));
+    outFix = FIX_TO_FLOAT(pidFixUpdate(&pidFix, fixFromFloat(measured, FIX_Q16), true), FIX_Q16);
+
+    if (fabsf(outFix - out) - PID_RELATIVE_TOLERANCE * fabsf(out) > worst)
+      worst = fabsf(outFix - out) - PID_RELATIVE_TOLERANCE * fabsf(out);
+  }
+
+  printf("  %-9s worst error beyond the relative tolerance %.4f\n", name, worst);
+  check(worst <= PID_ABSOLUTE_TOLERANCE, name);
+}
+
+static void testFusion(void)
+{
+  float worst = 0, err;
+  int i;
+
+  for (i = 0; i < FUSION_STEPS; i++)
+  {
+    float t = i * FUSION_DT;
+    // Rocking motion with the gyro slightly biased, gravity from the float
+    // estimate tilted a bit so that the feedback has something to correct.
+    float gx = 40 * sinf(2 * t) + 0.3f;
+    float gy = 25 * cosf(3 * t);
+    float gz = 10 * sinf(0.5f * t);
+    float ax = 2 * (q1 * q3 - q0 * q2) + 0.02f;
+    float ay = 2 * (q0 * q1 + q2 * q3);
+    float az = q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3;
+
+    // Change the gains while running, the fixed point copies must follow
+    if (i == FUSION_STEPS / 2)
+    {
+      twoKp = fix_twoKp = 2.0f * 1.0f;
+      twoKi = fix_twoKi = 2.0f * 0.01f;
+    }
+
+    sensfusion6UpdateQ(gx, gy, gz, ax, ay, az, FUSION_DT);
+    fix_sensfusion6UpdateQ(gx, gy, gz, ax, ay, az, FUSION_DT);
+
+    err = fmaxf(fmaxf(fabsf(fix_q0 - q0), fabsf(fix_q1 - q1)),
+                fmaxf(fabsf(fix_q2 - q2), fabsf(fix_q3 - q3)));
+    if (err > worst)
+      worst = err;
+  }
+
+  printf("  mahony    worst quaternion difference %.6f\n", worst);
+  check(worst <= FUSION_TOLERANCE, "mahony");
+}
+
+int main(void)
+{
+  testFixFromFloat();
+  testPid(PID_YAW_RATE_KP, PID_YAW_RATE_KI, PID_YAW_RATE_KD, PID_YAW_RATE_INTEGRATION_LIMIT,
+          1.0f / 500, 100.0f, "pid rate");
+  testPid(PID_YAW_KP, PID_YAW_KI, PID_YAW_KD, PID_YAW_INTEGRATION_LIMIT,
+          1.0f / 250, 20.0f, "pid att");
+  testFusion();
+
+  if (failures)
+  {
+    printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * Host test of the log and param TOC name lookup (namehash.c): colliding
+ * names, duplicates, missing names and a full table.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "namehash.h"
+
+#define TABLE_SIZE 8
+
+struct item { const char * group; const char * name; };
+
+static struct item items[TABLE_SIZE + 1];
+static int itemCount;
+static uint16_t slots[TABLE_SIZE];
+static NameHash table = { slots, TABLE_SIZE, 0, 0 };
+
+static int failures;
+
+static const char * itemGroup(int id) { return items[id].group; }
+static const char * itemName(int id) { return items[id].name; }
+
+static void check(int ok, const char* what)
+{
+  if (!ok)
+  {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static void reset(void)
+{
+  memset(slots, 0, sizeof(slots));
+  itemCount = 0;
+}
+
+static bool add(const char * group, const char * name)
+{
+  items[itemCount].group = group;
+  items[itemCount].name = name;
+  return nameHashInsert(&table, itemCount++);
+}
+
+static void testCollisions(void)
+{
+  static char names[4][12];
+  uint32_t slot = nameHashOf("g", "v0") & (TABLE_SIZE - 1);
+  int n = 0;
+  int i;
+
+  // Names that all land in the same slot, they are probed in turn
+  reset();
+  for (i = 0; n < 4; i++)
+  {
+    snprintf(names[n], sizeof(names[n]), "v%d", i);
+    if ((nameHashOf("g", names[n]) & (TABLE_SIZE - 1)) == slot)
+      add("g", names[n++]);
+  }
+  for (i = 0; i < 4; i++)
+    check(nameHashFind(&table, "g", names[i]) == i, "colliding name found");
+
+  // Same name in groups that land in the same slot
+  reset();
+  add("g0", "x");
+  slot = nameHashOf("g0", "x") & (TABLE_SIZE - 1);
+  for (i = 1; ; i++)
+  {
+    snprintf(names[0], sizeof(names[0]), "g%d", i);
+    if ((nameHashOf(names[0], "x") & (TABLE_SIZE - 1)) == slot)
+      break;
+  }
+  check(nameHashFind(&table, names[0], "x") == -1, "missing group in a used slot");
+  add(names[0], "x");
+  check(nameHashFind(&table, "g0", "x") == 0, "first group found");
+  check(nameHashFind(&table, names[0], "x") == 1, "second group found");
+
+  // Same "group.name" string, so the same hash, but different items
+  reset();
+  add("a.b", "c");
+  add("a", "b.c");
+  check(nameHashOf("a.b", "c") == nameHashOf("a", "b.c"), "equal hash");
+  check(nameHashFind(&table, "a.b", "c") == 0, "group with a dot");
+  check(nameHashFind(&table, "a", "b.c") == 1, "name with a dot");
+}
+
+static void testDuplicates(void)
+{
+  reset();
+  add("pid", "kp");
+  add("pid", "ki");
+  add("pid", "kp");
+  check(nameHashFind(&table, "pid", "kp") == 0, "first duplicate found");
+  check(nameHashFind(&table, "pid", "ki") == 1, "item after a duplicate");
+}
+
+static void testMissing(void)
+{
+  reset();
+  check(nameHashFind(&table, "pid", "kp") == -1, "empty table");
+
+  add("pid", "kp");
+  add("pid", "ki");
+  check(nameHashFind(&table, "pid", "kd") == -1, "missing name");
+  check(nameHashFind(&table, "pidx", "kp") == -1, "missing group");
+  check(nameHashFind(&table, "", "") == -1, "empty names");
+}
+
+static void testFull(void)
+{
+  static char names[TABLE_SIZE][12];
+  int i;
+
+  reset();
+  for (i = 0; i < TABLE_SIZE; i++)
+  {
+    snprintf(names[i], sizeof(names[i]), "v%d", i);
+    check(add("g", names[i]), "insert until full");
+  }
+  check(!add("g", "extra"), "insert in a full table");
+
+  // No free slot ends the probe, it has to stop after one turn
+  check(nameHashFind(&table, "g", "extra") == -1, "missing name in a full table");
+  for (i = 0; i < TABLE_SIZE; i++)
+    check(nameHashFind(&table, "g", names[i]) == i, "name in a full table");
+}
+
+int main(void)
+{
+  table.group = itemGroup;
+  table.name = itemName;
+
+  testCollisions();
+  testDuplicates();
+  testMissing();
+  testFull();
+
+  if (failures)
+  {
+    printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+
+  return 0;
+}
@@ -31,4 +31,24 @@
 
 int16_t iirLPFilterSingle(int32_t in, int32_t attenuation,  int32_t* filt);
 
+/**
+ * Second order Butterworth low pass filter, in direct form II.
+ */
+typedef struct {
+  float b0;
+  float b1;
+  float b2;
+  float a1;
+  float a2;
+  float delay1;
+  float delay2;
+} lpf2pData;
+
+void lpf2pInit(lpf2pData* lpfData, float sampleFreq, float cutoffFreq);
+float lpf2pApply(lpf2pData* lpfData, float sample);
+/**
+ * Set the filter state as if it had settled on 'sample'.
+ */
+void lpf2pReset(lpf2pData* lpfData, float sample);
+
 #endif //FILTER_H_
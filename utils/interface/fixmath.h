@@ -0,0 +1,86 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * fixmath.h - Fixed point math for targets without FPU
+ */
+#ifndef FIXMATH_H_
+#define FIXMATH_H_
+#include <stdint.h>
+
+/* Q formats used by the fixed point control path. */
+#define FIX_Q16  16
+#define FIX_Q24  24
+#define FIX_Q29  29
+#define FIX_Q30  30
+
+#define FIX_ONE(q)  ((int32_t)(1L << (q)))
+
+/* Conversions. The constant scale is folded so each costs one multiply. */
+#define FIX_FROM_FLOAT(x, q)  ((int32_t)((x) * (float)(1ULL << (q))))
+#define FIX_TO_FLOAT(x, q)    ((float)(x) * (1.0f / (float)(1ULL << (q))))
+
+/**
+ * Convert a float to Qq with integer operations only, for run time values on
+ * targets without FPU. Truncates towards zero like a cast and saturates to
+ * the int32 range.
+ */
+static inline int32_t fixFromFloat(float x, int q)
+{
+  union { float f; uint32_t u; } v = { .f = x };
+  int exponent = (int)((v.u >> 23) & 0xFF);
+  int shift = exponent - 127 - 23 + q;
+  int32_t mantissa;
+
+  // Zero and denormals
+  if (exponent == 0)
+    return 0;
+
+  mantissa = (int32_t)((v.u & 0x7FFFFF) | 0x800000);
+  if (shift >= 8)
+    return (v.u & 0x80000000) ? -INT32_MAX : INT32_MAX;
+  else if (shift >= 0)
+    mantissa <<= shift;
+  else if (shift > -24)
+    mantissa >>= -shift;
+  else
+    mantissa = 0;
+
+  return (v.u & 0x80000000) ? -mantissa : mantissa;
+}
+
+/**
+ * Multiply two fixed point numbers. The product is shifted right by 'shift',
+ * i.e. Qa * Qb >> (a + b - c) gives a Qc result.
+ */
+static inline int32_t fixMul(int32_t a, int32_t b, int shift)
+{
+  return (int32_t)(((int64_t)a * b) >> shift);
+}
+
+/**
+ * Normalize a 3D vector, in any Q format, to a unit vector in Q29.
+ * A zero vector is left unchanged.
+ */
+void fixNormalize3(int32_t* x, int32_t* y, int32_t* z);
+
+#endif //FIXMATH_H_
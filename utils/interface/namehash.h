@@ -0,0 +1,56 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2016 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * namehash.h - Lookup of log and param TOC ids by group and name
+ */
+#ifndef NAMEHASH_H_
+#define NAMEHASH_H_
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Open addressing table from the FNV-1a hash of "group.name" to TOC id + 1,
+ * 0 is a free slot. The names are not copied, they are read back from the
+ * TOC through the group and name callbacks when a lookup compares them.
+ */
+typedef struct {
+  uint16_t * slots;                 //< Zeroed table of size entries
+  uint16_t size;                    //< Power of two, larger than the TOC
+  const char * (*group)(int id);    //< Group name of a TOC id
+  const char * (*name)(int id);     //< Name of a TOC id
+} NameHash;
+
+uint32_t nameHashOf(const char * group, const char * name);
+
+/**
+ * Add TOC id. A duplicated name stays behind the first one, which is the one
+ * found. Returns false if the table is full.
+ */
+bool nameHashInsert(NameHash * table, int id);
+
+/**
+ * Returns the TOC id of group.name or -1.
+ */
+int nameHashFind(const NameHash * table, const char * group, const char * name);
+
+#endif //NAMEHASH_H_
@@ -0,0 +1,101 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * seqlock.h - Lock free single writer publishing
+ */
+#ifndef SEQLOCK_H_
+#define SEQLOCK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Sequence lock with two copies of the data (a "latch"). One writer
+ * publishes, any number of readers copy without locks. The writer never
+ * waits, and readers never wait on a writer they have preempted: while one
+ * copy is written readers are pointed to the other one. A reader only
+ * retries if the writer ran while it was copying.
+ *
+ * Writer:
+ *   seqlockWriteBegin(&lock);       // Readers use copy 1
+ *   data[0] = state;
+ *   seqlockWriteSwitch(&lock);      // Readers use copy 0
+ *   data[1] = state;
+ *
+ * Reader:
+ *   do {
+ *     seq = seqlockReadBegin(&lock);
+ *     copy = data[seqlockReadIndex(seq)];
+ *   } while (seqlockReadRetry(&lock, seq));
+ *
+ * The Cortex-M cores used are single core and do not reorder memory accesses
+ * as seen from another task, so a compiler barrier is enough.
+ */
+typedef struct
+{
+  volatile uint32_t sequence;
+} seqlock_t;
+
+#define SEQLOCK_BARRIER() __asm__ volatile ("" ::: "memory")
+
+static inline void seqlockInit(seqlock_t* lock)
+{
+  lock->sequence = 0;
+}
+
+static inline void seqlockWriteBegin(seqlock_t* lock)
+{
+  lock->sequence++;
+  SEQLOCK_BARRIER();
+}
+
+static inline void seqlockWriteSwitch(seqlock_t* lock)
+{
+  SEQLOCK_BARRIER();
+  lock->sequence++;
+  SEQLOCK_BARRIER();
+}
+
+static inline uint32_t seqlockReadBegin(const seqlock_t* lock)
+{
+  uint32_t sequence = lock->sequence;
+
+  SEQLOCK_BARRIER();
+  return sequence;
+}
+
+/**
+ * @return The copy that is not being written for the given sequence.
+ */
+static inline int seqlockReadIndex(uint32_t sequence)
+{
+  return sequence & 1;
+}
+
+static inline bool seqlockReadRetry(const seqlock_t* lock, uint32_t sequence)
+{
+  SEQLOCK_BARRIER();
+  return lock->sequence != sequence;
+}
+
+#endif /* SEQLOCK_H_ */
@@ -23,6 +23,8 @@
  *
  * filter.h - Filtering functions
  */
+#include <math.h>
+
 #include "filter.h"
 
 /**
@@ -53,3 +55,38 @@ int16_t iirLPFilterSingle(int32_t in, int32_t attenuation,  int32_t* filt)
 
   return out;
 }
+
+void lpf2pInit(lpf2pData* lpfData, float sampleFreq, float cutoffFreq)
+{
+  float fr = sampleFreq / cutoffFreq;
+  float ohm = tanf((float)M_PI / fr);
+  float c = 1.0f + 2.0f * cosf((float)M_PI / 4.0f) * ohm + ohm * ohm;
+
+  lpfData->b0 = ohm * ohm / c;
+  lpfData->b1 = 2.0f * lpfData->b0;
+  lpfData->b2 = lpfData->b0;
+  lpfData->a1 = 2.0f * (ohm * ohm - 1.0f) / c;
+  lpfData->a2 = (1.0f - 2.0f * cosf((float)M_PI / 4.0f) * ohm + ohm * ohm) / c;
+  lpfData->delay1 = 0.0f;
+  lpfData->delay2 = 0.0f;
+}
+
+float lpf2pApply(lpf2pData* lpfData, float sample)
+{
+  float delay0 = sample - lpfData->delay1 * lpfData->a1 - lpfData->delay2 * lpfData->a2;
+  float out = delay0 * lpfData->b0 + lpfData->delay1 * lpfData->b1 + lpfData->delay2 * lpfData->b2;
+
+  lpfData->delay2 = lpfData->delay1;
+  lpfData->delay1 = delay0;
+
+  return out;
+}
+
+void lpf2pReset(lpf2pData* lpfData, float sample)
+{
+  // In steady state delay0 = delay1 = delay2 = sample / (1 + a1 + a2)
+  float delay = sample / (1.0f + lpfData->a1 + lpfData->a2);
+
+  lpfData->delay1 = delay;
+  lpfData->delay2 = delay;
+}
@@ -0,0 +1,72 @@
+/*
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2015 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * fixmath.c - Fixed point math for targets without FPU
+ */
+#include "fixmath.h"
+
+#define INVSQRT_NEWTON_ITERATIONS 4
+
+/**
+ * 1/sqrt(m) for m in [0.25, 1) given in Q32. Returns Q30 in (1, 2].
+ */
+static uint32_t fixInvSqrtNormalized(uint32_t m)
+{
+  uint32_t r;
+  uint64_t r2;
+  int64_t t;
+  int i;
+
+  // Linear first guess through (0.25, 2) and (1, 1), then Newton iterations
+  // r = r * (3 - m * r^2) / 2
+  r = (2UL << FIX_Q30) - 1 - (uint32_t)(((uint64_t)(m - (1UL << 30)) * 4 / 3) >> 2);
+  for (i = 0; i < INVSQRT_NEWTON_ITERATIONS; i++)
+  {
+    r2 = ((uint64_t)r * r) >> FIX_Q30;
+    t = (3LL << FIX_Q30) - (int64_t)(((uint64_t)m * r2) >> 32);
+    r = (uint32_t)(((uint64_t)r * (uint64_t)t) >> (FIX_Q30 + 1));
+  }
+
+  return r;
+}
+
+void fixNormalize3(int32_t* x, int32_t* y, int32_t* z)
+{
+  uint64_t s = (uint64_t)((int64_t)*x * *x) + (uint64_t)((int64_t)*y * *y) +
+               (uint64_t)((int64_t)*z * *z);
+  int shift;
+  uint32_t r;
+
+  if (s == 0)
+    return;
+
+  // Scale s by an even power of two into [2^62, 2^64), the top 32 bits is
+  // then m in [0.25, 1) in Q32 and sqrt(s) = sqrt(m) * 2^(32 - shift/2).
+  shift = __builtin_clzll(s) & ~1;
+  r = fixInvSqrtNormalized((uint32_t)((s << shift) >> 32));
+
+  // v / sqrt(s) in Q29 = v * r(Q30) >> (33 - shift/2)
+  *x = (int32_t)(((int64_t)*x * r) >> (33 - shift / 2));
+  *y = (int32_t)(((int64_t)*y * r) >> (33 - shift / 2));
+  *z = (int32_t)(((int64_t)*z * r) >> (33 - shift / 2));
+}
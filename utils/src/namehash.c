@@ -0,0 +1,80 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2016 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * namehash.c - Lookup of log and param TOC ids by group and name
+ */
+#include <string.h>
+
+#include "namehash.h"
+
+uint32_t nameHashOf(const char * group, const char * name)
+{
+  // FNV-1a over "group.name"
+  uint32_t hash = 2166136261u;
+
+  while (*group)
+    hash = (hash ^ (uint8_t)*group++) * 16777619u;
+  hash = (hash ^ '.') * 16777619u;
+  while (*name)
+    hash = (hash ^ (uint8_t)*name++) * 16777619u;
+
+  return hash;
+}
+
+bool nameHashInsert(NameHash * table, int id)
+{
+  uint32_t slot = nameHashOf(table->group(id), table->name(id));
+  int i;
+
+  for (i=0; i<table->size; i++, slot++)
+  {
+    slot &= table->size - 1;
+    if (table->slots[slot] == 0)
+    {
+      table->slots[slot] = id + 1;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+int nameHashFind(const NameHash * table, const char * group, const char * name)
+{
+  uint32_t slot = nameHashOf(group, name);
+  int i;
+  int id;
+
+  for (i=0; i<table->size; i++, slot++)
+  {
+    slot &= table->size - 1;
+    if (table->slots[slot] == 0)
+      break;
+
+    id = table->slots[slot] - 1;
+    if (!strcmp(name, table->name(id)) && !strcmp(group, table->group(id)))
+      return id;
+  }
+
+  return -1;
+}